@@ -1,7 +1,6 @@
 // Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
 // Licensed under the MIT License. See LICENSE for details.
 
-#include <condition_variable>
 #include <iostream>
 #include <set>
 
@@ -10,37 +9,14 @@
 const bool debug = false;
 enum { HEADER_SIZE = 16 };
 
-class Client;
 class ApiWorkers {
 public:
-	struct OutputQueue;
 	struct WorkItem {
-		OutputQueue *output_queue = nullptr;
-		void *client              = nullptr;  // TODO - fix this crap. We never destroy clients, so pointer is safe
-		size_t client_id          = 0;        // But client ids change, so we know the work done is for disconnected one
+		void *client     = nullptr;  // TODO - fix this crap. We never destroy clients, so pointer is safe
+		size_t client_id = 0;        // But client ids change, so we know the work done is for disconnected one
 		crab::Buffer request{0};
 		crab::Buffer response{0};
 	};
-	struct OutputQueue {
-		std::mutex worker_responses_mutex;
-		std::deque<WorkItem> worker_responses;
-		crab::Watcher worker_ready_ab;
-
-		explicit OutputQueue(crab::Handler &&handler) : worker_ready_ab(std::move(handler)) {}
-	};
-	ApiWorkers() {
-		for (size_t i = 0; i != 2; ++i)
-			worker_threads.emplace_back(&ApiWorkers::worker_fun, this);
-	}
-	~ApiWorkers() {
-		{
-			std::unique_lock<std::mutex> lock(worker_requests_mutex);
-			worker_should_quit = true;
-			worker_requests_cond.notify_all();
-		}
-		for (auto &th : worker_threads)
-			th.join();
-	}
 
 	static void process_work_item(const crab::Buffer &request, crab::Buffer &response) {
 		size_t len = request.size();
@@ -49,43 +25,13 @@ public:
 		response.did_write(HEADER_SIZE - 4);  // TODO security issue, uninitialized memory
 		response.did_write(len);              // TODO security issue, uninitialized memory
 	}
-	void add_work(WorkItem &&work_item) {
-		std::unique_lock<std::mutex> lock(worker_requests_mutex);
-		worker_requests.push_back(std::move(work_item));
-		worker_requests_cond.notify_one();
+	// Completion is called on the loop, which added work, completions are batched by pool
+	void add_work(std::shared_ptr<WorkItem> work_item, crab::Handler &&completion) {
+		pool.submit([work_item]() { process_work_item(work_item->request, work_item->response); }, std::move(completion));
 	}
 
 private:
-	std::mutex worker_requests_mutex;
-	bool worker_should_quit = false;
-	std::condition_variable worker_requests_cond;
-	std::deque<WorkItem> worker_requests;
-
-	std::vector<std::thread> worker_threads;
-
-	void worker_fun() {
-		WorkItem work_item;
-		while (true) {
-			{
-				std::unique_lock<std::mutex> lock(worker_requests_mutex);
-				if (worker_should_quit)
-					return;
-				if (worker_requests.empty()) {
-					worker_requests_cond.wait(lock);
-					continue;
-				}
-				work_item = std::move(worker_requests.front());
-				worker_requests.pop_front();
-			}
-			process_work_item(work_item.request, work_item.response);
-			auto output_queue = work_item.output_queue;
-			{
-				std::unique_lock<std::mutex> lock(output_queue->worker_responses_mutex);
-				output_queue->worker_responses.push_back(std::move(work_item));
-			}
-			output_queue->worker_ready_ab.call();  // Wake up correct network thread
-		}
-	}
+	crab::WorkerPool pool;
 };
 
 class ApiNetwork {
@@ -96,7 +42,6 @@ public:
 	          bind_address,
 	          [&]() { accept_all(); },
 	          settings)
-	    , output_queue([&]() { on_worker_ready_ab(); })
 	    , stat_timer([&]() { print_stats(); }) {
 		print_stats();
 	}
@@ -164,8 +109,6 @@ private:
 	// callbacks for such clients are ignored
 	// client is put in fair_queue if it has more than 1 request pending (sending batch requests)
 
-	ApiWorkers::OutputQueue output_queue;
-
 	// IntrusiveList is good as a queue due to O(1) removal cost and auto-remove in Node destructor
 
 	crab::Timer stat_timer;
@@ -282,15 +225,14 @@ private:
 			return true;
 		}
 		total_response_memory += max_response_length;
-		ApiWorkers::WorkItem work_item;
-		work_item.output_queue = &output_queue;
-		work_item.client_id    = client.client_id;
-		work_item.client       = &client;
-		work_item.request      = std::move(client.requests.front());
+		auto work_item       = std::make_shared<ApiWorkers::WorkItem>();
+		work_item->client_id = client.client_id;
+		work_item->client    = &client;
+		work_item->request   = std::move(client.requests.front());
 		client.requests.pop_front();
 		client.requests_in_work += 1;
 
-		api_workers.add_work(std::move(work_item));
+		api_workers.add_work(work_item, [this, work_item]() { on_work_done(*work_item); });
 		return true;
 	}
 	void run_workers_fair() {
@@ -305,29 +247,17 @@ private:
 				response_memory_queue.push_back(client);
 		}
 	}
-	std::deque<ApiWorkers::WorkItem> worker_responses_taken;
-	void on_worker_ready_ab() {
-		{
-			// Do not stop workers pushing into worker_responses, do not allocate memory
-			std::unique_lock<std::mutex> lock(output_queue.worker_responses_mutex);
-			worker_responses_taken.swap(output_queue.worker_responses);  // each iteration 2 containers are swapped
-		}
-		for (auto &w : worker_responses_taken) {
-			total_response_memory -= max_response_length;
-			total_requests_memory -= w.request.capacity();
-			Client &client = *reinterpret_cast<Client *>(w.client);
-			if (client.client_id != w.client_id) {  // Disconnected/reconnected
-				continue;
-			}
-			total_response_memory += w.response.capacity();
-			client.requests_in_work -= 1;
-			responses_sent += 1;
-			//			const bool was_empty = w.client->responses.empty();
-			client.responses.push_back(std::move(w.response));
-			//			if (was_empty) // TODO - check if this optimization is useful
-			send_responses(client);
-		}
-		worker_responses_taken.clear();
+	void on_work_done(ApiWorkers::WorkItem &w) {
+		total_response_memory -= max_response_length;
+		total_requests_memory -= w.request.capacity();
+		Client &client = *reinterpret_cast<Client *>(w.client);
+		if (client.client_id != w.client_id)  // Disconnected/reconnected
+			return;
+		total_response_memory += w.response.capacity();
+		client.requests_in_work -= 1;
+		responses_sent += 1;
+		client.responses.push_back(std::move(w.response));
+		send_responses(client);
 		read_requests_fair();  // if we read header, we could need to read body
 	}
 	void send_responses(Client &client) {
@@ -433,6 +363,9 @@ private:
 	void print_stats() {
 		stat_timer.once(1);
 		std::cout << "requests received/responses sent (during last second)=" << requests_received << "/" << responses_sent << std::endl;
+		const auto &pool = crab::SlabPool::current().get_stats();  // SLAB and HEAP counts stop growing in steady state
+		std::cout << "buffer pool alloc/free=" << pool.ALLOC_count << "/" << pool.FREE_count << " slabs=" << pool.SLAB_count
+		          << " depot refills=" << pool.DEPOT_count << " heap=" << pool.HEAP_count << std::endl;
 		//		if (!clients.empty()) {
 		//			std::cout << "Client.front read=" << clients.front().total_read
 		//			          << " written=" << clients.front().total_written << std::endl;
@@ -222,6 +222,11 @@ private:
 	size_t total_read    = 0;
 	size_t total_written = 0;
 
+	std::vector<crab::UDPReceiver::DatagramBuffer> buffers =
+	    std::vector<crab::UDPReceiver::DatagramBuffer>(crab::UDPReceiver::MAX_DATAGRAMS_BATCH);
+	std::vector<crab::ConstSlice> slices;
+	std::vector<crab::Address> peer_addrs;
+
 	crab::Timer stat_timer;
 	size_t requests_received = 0;
 	size_t responses_sent    = 0;
@@ -235,14 +240,17 @@ private:
 		}
 	}
 	void socket_handler() {
-		uint8_t data[crab::UDPReceiver::MAX_DATAGRAM_SIZE];  // uninitialized
-		crab::Address peer_addr;
-		while (auto a = socket.read_datagram(data, sizeof(data), &peer_addr)) {
-			auto data_len = *a;
-			ApiHeader header;
-			memcpy(&header, data, sizeof(header));
-			if (!socket.write_datagram(data, data_len, peer_addr)) {
-				std::cout << "socket.write_datagram failed" << std::endl;
+		// Batch of requests is read with single recvmmsg, responses are sent with single sendmmsg
+		while (size_t count = socket.read_datagrams(buffers.data(), buffers.size())) {
+			slices.clear();
+			peer_addrs.clear();
+			for (size_t i = 0; i != count; ++i) {
+				slices.push_back(crab::ConstSlice{buffers[i].data, buffers[i].count});
+				peer_addrs.push_back(buffers[i].peer_addr);
+			}
+			const size_t sent = socket.write_datagrams(slices.data(), peer_addrs.data(), count);
+			if (sent != count) {
+				std::cout << "socket.write_datagrams failed for " << count - sent << " datagrams" << std::endl;
 			}
 		}
 	}
@@ -5,18 +5,32 @@
 
 #include <crab/crab.hpp>
 
+static void print_names(const std::vector<crab::Address> &result) {
+	std::cout << "names resolved" << std::endl;
+	for (const auto &na : result) {
+		std::cout << " name resolved=" << na.get_address() << ":" << na.get_port() << std::endl;
+	}
+	crab::RunLoop::current()->cancel();
+}
+
 int main(int argc, char *argv[]) {
 	std::cout << "crablib version " << crab::version_string() << std::endl;
 
 	crab::RunLoop runloop;
 
-	crab::DNSResolver res([](const std::vector<crab::Address> &result) {
-		std::cout << "names resolved" << std::endl;
-		for (const auto &na : result) {
-			std::cout << " name resolved=" << na.get_address() << ":" << na.get_port() << std::endl;
-		}
-		crab::RunLoop::current()->cancel();
-	});
+	if (argc >= 3 && std::string(argv[1]) == "--stub") {
+		// Non-blocking resolver, try with stub server, for example dnsmasq --no-daemon --port 5353 --address=/test/1.2.3.4
+		crab::DNSStubResolver::Settings settings;
+		if (argc >= 4)
+			settings.servers.push_back(crab::Address(argv[3]));
+		crab::DNSStubResolver res(print_names, settings);
+		res.resolve(argv[2], 80, true, true);
+		runloop.run();
+		return 0;
+	}
+	std::cout << "Use --stub <host> [<server ip:port>] to test DNSStubResolver" << std::endl;
+
+	crab::DNSResolver res(print_names);
 
 	//  Uncomment next 3 lines for some async dance
 	res.resolve("alawar.com", 80, true, true);
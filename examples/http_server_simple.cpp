@@ -2,6 +2,7 @@
 // Licensed under the MIT License. See LICENSE for details.
 
 #include <iostream>
+#include <sstream>
 
 #include <crab/crab.hpp>
 
@@ -17,6 +18,24 @@ int main() {
 	http::Server server(7000);
 
 	server.r_handler = [&](http::Client *who, http::Request &&request) {
+		if (request.header.path == "/trace") {  // Save and open in ui.perfetto.dev, needs CRAB_TRACING=1
+			std::stringstream trace;
+			runloop.stats.write_chrome_trace(trace);
+			http::Response response;
+			response.header.status = 200;
+			response.header.set_content_type("application/json", "charset=utf-8");
+			response.set_body(trace.str());
+			who->write(std::move(response));
+			return;
+		}
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+		if (request.header.path.compare(0, 8, "/static/") == 0 && request.header.path.find("..") == std::string::npos) {
+			// Files from current directory, sent with sendfile, try curl -r 0-9 or If-None-Match with etag
+			if (!who->write_file(request.header, request.header.path.substr(8)))
+				who->write(http::Response::simple_text(404));
+			return;
+		}
+#endif
 		bool cond = false;
 		std::cout << "Request" << std::endl;
 		for (const auto &q : request.parse_query_params()) {
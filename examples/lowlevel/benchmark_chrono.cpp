@@ -4,6 +4,9 @@
 #include <chrono>
 #include <functional>
 #include <iostream>
+#include <thread>
+
+#include <crab/crab.hpp>
 
 template<typename T>
 void benchmark() {
@@ -85,5 +88,18 @@ int main() {
 		return std::chrono::high_resolution_clock::now().time_since_epoch().count() +
 		       std::chrono::high_resolution_clock::now().time_since_epoch().count();
 	});
+	crab::FastClock fast_clock;
+	std::cout << "crab::FastClock uses " << (crab::FastClock::is_tsc() ? "TSC" : "steady_clock (TSC not invariant or not used by kernel)")
+	          << std::endl;
+	benchmark2("crab::FastClock", [&]() {
+		return fast_clock.now().time_since_epoch().count() + fast_clock.now().time_since_epoch().count();
+	});
+	for (int i = 0; i != 5; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+		const auto fast   = fast_clock.now();
+		const auto steady = std::chrono::steady_clock::now();
+		std::cout << "crab::FastClock - steady_clock ns=" << std::chrono::duration_cast<std::chrono::nanoseconds>(fast - steady).count()
+		          << std::endl;
+	}
 	return 0;
 }
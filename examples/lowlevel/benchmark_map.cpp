@@ -199,6 +199,15 @@ struct HeapElement {
 	bool operator<(const HeapElement &other) const { return value < other.value; }
 };
 
+struct HeapElementTimerPred {  // Min heap, like in crab::Timer
+	bool operator()(const HeapElement &a, const HeapElement &b) const { return a.value > b.value; }
+};
+
+struct WheelElement {
+	crab::IntrusiveNode<WheelElement> wheel_node;
+	uint64_t wheel_tick = 0;
+};
+
 struct HeapElementSteadyTimer {
 	crab::IntrusiveHeapIndex heap_index;
 	std::chrono::steady_clock::time_point value{};
@@ -227,6 +236,11 @@ void benchmark_timers() {
 	constexpr size_t COUNT_MOVE = 100;
 	crab::RunLoop runloop;
 
+#if CRAB_TIMER_WHEEL
+	std::cout << "crab::Timer is using IntrusiveTimerWheel" << std::endl;
+#else
+	std::cout << "crab::Timer is using IntrusiveHeap" << std::endl;
+#endif
 	Random random(12345);
 
 	std::vector<std::chrono::steady_clock::duration> durs;
@@ -264,6 +278,124 @@ void benchmark_timers() {
 	          << " count=" << COUNT << ", seconds=" << double(idea_ms.count()) / 1000 << std::endl;
 }
 
+// Timer reschedules itself with random delay of 50..550 mksec, like pacing logic does.
+// Lateness is measured from fire time set by Timer::once() to the moment handler runs
+class TimerLatenessApp {
+public:
+	explicit TimerLatenessApp(size_t count) : timer([this]() { on_timer(); }), count(count) { set_next(); }
+	void print(const char *name) const {
+		const auto snapshot = lateness.snapshot();
+		std::cout << name << " lateness mksec p50=" << double(snapshot.percentile(0.5)) / 1000
+		          << " p99=" << double(snapshot.percentile(0.99)) / 1000 << " max=" << double(snapshot.max_value()) / 1000
+		          << " samples=" << snapshot.total << std::endl;
+	}
+
+private:
+	void on_timer() {
+		const auto late = std::chrono::steady_clock::now() - fire_time;
+		lateness.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(late).count()));
+		if (++fired == count)
+			return crab::RunLoop::current()->cancel();
+		set_next();
+	}
+	void set_next() {
+		const auto delay = std::chrono::microseconds(50 + random.rnd() % 500);
+		fire_time        = crab::RunLoop::current()->now() + delay;
+		timer.once(delay);
+	}
+	crab::Timer timer;
+	size_t count;
+	size_t fired = 0;
+	std::chrono::steady_clock::time_point fire_time;
+	Random random{12345};
+	crab::Histogram lateness;
+};
+
+void benchmark_timer_lateness() {
+	constexpr size_t COUNT = 2000;
+	for (bool precise : {false, true}) {
+		crab::RunLoop runloop;
+		runloop.set_precise_timers(precise);
+		TimerLatenessApp app(COUNT);
+		runloop.run();
+		app.print(precise ? "Precise timers" : "Default timers");
+	}
+}
+
+// Timer workload directly on containers, tick is 1ms, like in crab::RunLoop
+// insert - set timers, reschedule - cancel + set (TCP timeout on each packet),
+// fire - advance time by 1 tick until all timers fire
+void benchmark_timer_containers() {
+	constexpr size_t COUNT      = 1000000;
+	constexpr size_t MAX_DELAY  = 60000;  // 1 minute
+	constexpr size_t RESCHEDULE = 10;
+
+	Random random(12345);
+	std::vector<uint64_t> ticks;
+	for (size_t i = 0; i != COUNT * (RESCHEDULE + 1); ++i)
+		ticks.push_back(random.rnd() % MAX_DELAY);
+
+	auto report = [](const char *str, size_t count, std::chrono::high_resolution_clock::time_point idea_start) {
+		auto idea_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - idea_start);
+		std::cout << str << " count=" << count << ", seconds=" << double(idea_ms.count()) / 1000 << std::endl;
+	};
+	{
+		std::vector<HeapElement> elements(COUNT);
+		crab::IntrusiveHeap<HeapElement, &HeapElement::heap_index, HeapElementTimerPred> heap;
+		heap.reserve(COUNT);
+		auto idea_start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i != COUNT; ++i) {
+			elements[i].value = ticks[i];
+			heap.insert(elements[i]);
+		}
+		report("IntrusiveHeap insert", COUNT, idea_start);
+		idea_start = std::chrono::high_resolution_clock::now();
+		for (size_t j = 1; j != RESCHEDULE + 1; ++j)
+			for (size_t i = 0; i != COUNT; ++i) {
+				heap.erase(elements[i]);
+				elements[i].value = ticks[j * COUNT + i];
+				heap.insert(elements[i]);
+			}
+		report("IntrusiveHeap reschedule", COUNT * RESCHEDULE, idea_start);
+		idea_start   = std::chrono::high_resolution_clock::now();
+		size_t fired = 0;
+		for (uint64_t tick = 0; !heap.empty(); ++tick)
+			while (!heap.empty() && heap.front().value <= tick) {
+				heap.pop_front();
+				fired += 1;
+			}
+		report("IntrusiveHeap fire", fired, idea_start);
+	}
+	{
+		std::vector<WheelElement> elements(COUNT);
+		crab::IntrusiveTimerWheel<WheelElement, &WheelElement::wheel_node, &WheelElement::wheel_tick> wheel;
+		auto idea_start = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i != COUNT; ++i) {
+			elements[i].wheel_tick = ticks[i];
+			wheel.insert(elements[i]);
+		}
+		report("IntrusiveTimerWheel insert", COUNT, idea_start);
+		idea_start = std::chrono::high_resolution_clock::now();
+		for (size_t j = 1; j != RESCHEDULE + 1; ++j)
+			for (size_t i = 0; i != COUNT; ++i) {
+				wheel.erase(elements[i]);
+				elements[i].wheel_tick = ticks[j * COUNT + i];
+				wheel.insert(elements[i]);
+			}
+		report("IntrusiveTimerWheel reschedule", COUNT * RESCHEDULE, idea_start);
+		idea_start   = std::chrono::high_resolution_clock::now();
+		size_t fired = 0;
+		for (uint64_t tick = 0; !wheel.empty(); ++tick) {
+			wheel.advance(tick);
+			while (wheel.has_expired()) {
+				wheel.erase(wheel.front_expired());
+				fired += 1;
+			}
+		}
+		report("IntrusiveTimerWheel fire", fired, idea_start);
+	}
+}
+
 template<class T, class Op>
 void benchmark_op(const char *str, const std::vector<T> &samples, Op op) {
 	size_t found_counter = 0;
@@ -518,6 +650,8 @@ struct hash<OrderId> {
 
 int main() {
 	benchmark_timers();
+	benchmark_timer_lateness();
+	benchmark_timer_containers();
 	benchmark_sets();
 	std::cout << "Testing small std::map<int> count=" << COUNT << std::endl;
 	benchmark<int, std::map<int, size_t>>(small_int_gen);
@@ -10,28 +10,43 @@
 
 class MDClientApp {
 public:
-	explicit MDClientApp(const MDSettings &settings) : settings(settings), udp_a(settings.md_gate_udp_a(), [&]() { on_udp_a(); }) {}
+	explicit MDClientApp(const MDSettings &settings)
+	    : settings(settings), udp_a(settings.md_gate_udp_a(), [&]() { on_udp_a(); }, udp_a_settings()) {}
 
 private:
+	static crab::UDPReceiver::Settings udp_a_settings() {
+		crab::UDPReceiver::Settings result;
+		result.udp_gro       = true;  // Runs of datagrams sent by md_gate with GSO are received in single buffer
+		result.rx_timestamps = true;  // So latency includes time datagrams waited in socket buffer
+		return result;
+	}
 	void on_udp_a() {
-		uint8_t buffer[crab::UDPReceiver::MAX_DATAGRAM_SIZE];
-		while (true) {
-			auto rd = udp_a.read_datagram(buffer, sizeof(buffer));
-			if (!rd)
-				break;
-			if (*rd != Msg::size) {
-				std::cout << "Wrong message size, skipping" << std::endl;
-				continue;
+		while (size_t count = udp_a.read_datagrams(buffers.data(), buffers.size())) {
+			const auto now = std::chrono::system_clock::now();  // Kernel timestamps are CLOCK_REALTIME
+			for (size_t i = 0; i != count; ++i) {
+				const auto lat = std::chrono::duration_cast<std::chrono::microseconds>(now - buffers[i].timestamp).count();
+				for (size_t j = 0; j != buffers[i].datagram_count(); ++j)
+					on_datagram(buffers[i].datagram(j), lat);
 			}
+		}
+	}
+	void on_datagram(crab::ConstSlice datagram, long long kernel_lat) {
+		if (datagram.size % Msg::size != 0) {
+			std::cout << "Wrong datagram size, skipping" << std::endl;
+			return;
+		}
+		crab::IMemoryStream is(datagram.data, datagram.size);
+		while (is.size() != 0) {
 			Msg msg;
-			crab::IMemoryStream is(buffer, *rd);
 			msg.read(&is);
-			std::cout << "Msg with seq=" << msg.seqnum << std::endl;
+			std::cout << "Msg with seq=" << msg.seqnum << " kernel->handler=" << kernel_lat << "us" << std::endl;
 		}
 	}
 	const MDSettings settings;
 
 	crab::UDPReceiver udp_a;
+	std::vector<crab::UDPReceiver::DatagramBuffer> buffers =
+	    std::vector<crab::UDPReceiver::DatagramBuffer>(crab::UDPReceiver::MAX_DATAGRAMS_BATCH);
 };
 
 int main(int argc, char *argv[]) {
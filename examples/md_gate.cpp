@@ -31,9 +31,9 @@ public:
 	LowLatencyRetransmitter(const MDSettings &settings, std::function<void(Msg msg)> &&message_handler)
 	    : settings(settings)
 	    , upstream_socket([&]() { upstream_socket_handler(); })
-	    , upstream_socket_buffer(4096)
+	    , upstream_socket_buffer(65536)
 	    , message_handler(std::move(message_handler))
-	    , udp_a(settings.md_gate_udp_a(), [&]() {})  // We just skip packets if buffer is full in UDP line A
+	    , udp_a(settings.md_gate_udp_a(), [&]() {}, udp_a_settings())  // We just skip packets if buffer is full in UDP line A
 	    , reconnect_timer([&]() { connect(); })
 	    , simulated_disconnect_timer([&]() { on_simulated_disconnect_timer(); }) {
 		connect();
@@ -54,20 +54,28 @@ private:
 		if (rand() % 10 == 0)
 			simulated_disconnect();
 	}
+	static crab::UDPTransmitter::Settings udp_a_settings() {
+		crab::UDPTransmitter::Settings result;
+		result.udp_gso = true;  // Falls back to sendmmsg if not supported
+		return result;
+	}
 	void upstream_socket_handler() {
 		if (!upstream_socket.is_open())
 			return on_upstream_socket_closed();
 		while (true) {
 			if (upstream_socket_buffer.size() < Msg::size)
 				upstream_socket_buffer.read_from(upstream_socket);
-			const size_t max_count = MAX_DATAGRAM_SIZE / Msg::size;
-			size_t count           = std::min(max_count, upstream_socket_buffer.size() / Msg::size);
+			const size_t count = upstream_socket_buffer.size() / Msg::size;
 			if (count == 0)
 				break;
 			crab::VectorStream vs;
 			upstream_socket_buffer.write_to(vs, count * Msg::size);
-			if (!udp_a.write_datagram(vs.get_buffer().data(), vs.get_buffer().size())) {
-				std::cout << "UDP retransmission buffer full, dropping message" << std::endl;
+			// Run of datagrams of the same size (except the last one), kernel splits it with UDP GSO
+			const size_t datagram_size = (MAX_DATAGRAM_SIZE / Msg::size) * Msg::size;
+			const size_t datagrams     = (vs.size() + datagram_size - 1) / datagram_size;
+			const size_t sent          = udp_a.write_segmented(vs.get_buffer().data(), vs.get_buffer().size(), datagram_size);
+			if (sent != datagrams) {
+				std::cout << "UDP retransmission buffer full, dropping " << datagrams - sent << " datagrams" << std::endl;
 			}
 			while (vs.size() >= Msg::size) {
 				Msg msg;
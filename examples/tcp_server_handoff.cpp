@@ -0,0 +1,78 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#include <iostream>
+#include <list>
+
+#include <crab/crab.hpp>
+
+// Echo server, single acceptor in main loop hands connections to worker loops.
+// Use when SO_REUSEPORT is not available, or listening socket is passed from outside (--listen-fd)
+
+class EchoWorker {
+public:
+	EchoWorker() : receiver([&]() { accept_all(); }) {}
+
+	crab::TCPHandoffReceiver receiver;
+
+private:
+	void accept_all() {
+		while (receiver.can_accept()) {
+			clients.emplace_back([]() {});
+			auto it = --clients.end();
+			it->set_handler([this, it]() { on_client(it); });
+			it->accept(receiver);
+		}
+	}
+	void on_client(std::list<crab::TCPSocket>::iterator it) {
+		uint8_t buffer[4096];
+		while (it->is_open()) {
+			const size_t count = it->read_some(buffer, sizeof(buffer));
+			if (count == 0)
+				return;
+			it->write_some(buffer, count);  // Good enough for example
+		}
+		clients.erase(it);
+		receiver.connection_closed();
+	}
+	std::list<crab::TCPSocket> clients;
+};
+
+int main(int argc, char *argv[]) {
+	std::cout << "crablib version " << crab::version_string() << std::endl;
+
+	int listen_fd = -1;
+	auto policy   = crab::TCPHandoff::ROUND_ROBIN;
+	for (int i = 1; i < argc; ++i) {
+		if (std::string(argv[i]) == "--listen-fd" && i + 1 < argc)
+			listen_fd = std::stoi(argv[++i]);
+		if (std::string(argv[i]) == "--least-connections")
+			policy = crab::TCPHandoff::LEAST_CONNECTIONS;
+	}
+	std::cout << "Use --listen-fd <fd> to accept on inherited listening socket, --least-connections to change policy" << std::endl;
+
+	crab::RunLoop runloop;
+	crab::Signal stop([&]() { runloop.cancel(); });
+
+	crab::RunLoopGroup group;
+	std::vector<crab::TCPHandoffReceiver *> receivers(group.size());
+	group.start([&](size_t num) {
+		EchoWorker worker;
+		receivers.at(num) = &worker.receiver;
+		crab::RunLoop::current()->run();
+	});
+
+	crab::TCPAcceptor::Settings settings;
+	settings.reuse_addr = true;
+	std::unique_ptr<crab::TCPAcceptor> acceptor;
+	if (listen_fd >= 0)
+		acceptor.reset(new crab::TCPAcceptor(listen_fd, []() {}));
+	else
+		acceptor.reset(new crab::TCPAcceptor(crab::Address("0.0.0.0", 7000), []() {}, settings));
+	crab::TCPHandoff handoff(*acceptor, receivers, policy);
+	std::cout << "Echo server with " << group.size() << " worker threads" << std::endl;
+
+	runloop.run();
+	std::cout << "Stopping, " << handoff.get_handoff_count() << " connections were handed off" << std::endl;
+	return 0;
+}
@@ -1,6 +1,8 @@
 // Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
 // Licensed under the MIT License. See LICENSE for details.
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <mutex>
 #include <thread>
@@ -48,16 +50,130 @@ private:
 	std::thread th;
 };
 
+// Producers call watcher as fast as they can. Latency is measured from the first call
+// after previous on_call() of the same producer to the next on_call(), calls in between are coalesced.
+// With use_post, producers post closures instead, and latency of each closure is measured.
+class WatcherThroughputApp {
+public:
+	explicit WatcherThroughputApp(size_t producers_count, double seconds, bool use_post)
+	    : ab([&]() { on_call(); })
+	    , stop_timer([&]() { on_stop(); })
+	    , slots(producers_count)
+	    , loop(crab::RunLoop::current())
+	    , use_post(use_post) {
+		stop_timer.once(seconds);
+		start = steady_clock::now();
+		for (auto &slot : slots)
+			producers.emplace_back([&]() { producer_run(slot); });
+	}
+	~WatcherThroughputApp() { on_stop(); }
+
+private:
+	struct Slot {
+		std::atomic<int64_t> pending_since{0};  // steady_clock ticks, 0 - not pending
+		std::atomic<size_t> calls{0};
+	};
+	void producer_run(Slot &slot) {
+		size_t calls = 0;
+		while (!quit && use_post) {
+			const int64_t since = steady_clock::now().time_since_epoch().count();
+			loop->post([this, since]() { on_post(since); });
+			calls += 1;
+		}
+		while (!quit && !use_post) {
+			int64_t expected = 0;
+			slot.pending_since.compare_exchange_strong(expected, steady_clock::now().time_since_epoch().count());
+			ab.call();
+			calls += 1;
+		}
+		slot.calls = calls;
+	}
+	void on_call() {
+		const auto now = steady_clock::now().time_since_epoch().count();
+		on_call_count += 1;
+		for (auto &slot : slots) {
+			const int64_t since = slot.pending_since.exchange(0);
+			if (since != 0)
+				latencies.push_back(now - since);
+		}
+	}
+	void on_post(int64_t since) {
+		on_call_count += 1;
+		latencies.push_back(steady_clock::now().time_since_epoch().count() - since);
+	}
+	void on_stop() {
+		if (producers.empty())
+			return;
+		quit = true;
+		for (auto &p : producers)
+			p.join();
+		producers.clear();
+		const double seconds = std::chrono::duration<double>(steady_clock::now() - start).count();
+		size_t calls         = 0;
+		for (auto &slot : slots)
+			calls += slot.calls;
+		std::cout << "producers=" << slots.size() << " seconds=" << seconds << std::endl;
+		std::cout << "calls=" << calls << " (" << calls / seconds << " per second)" << std::endl;
+		std::cout << (use_post ? "handlers=" : "on_call=") << on_call_count << " (" << on_call_count / seconds << " per second)" << std::endl;
+		if (!latencies.empty()) {
+			std::sort(latencies.begin(), latencies.end());
+			auto percentile = [&](double p) -> double {
+				const auto ticks = latencies.at(static_cast<size_t>(p * (latencies.size() - 1)));
+				return std::chrono::duration<double, std::micro>(steady_clock::duration{ticks}).count();
+			};
+			std::cout << "latency mksec p50=" << percentile(0.5) << " p99=" << percentile(0.99) << " max=" << percentile(1)
+			          << " samples=" << latencies.size() << std::endl;
+		}
+		const auto &stats = crab::RunLoop::current()->stats;
+		std::cout << "loop polls (EPOLL_count)=" << stats.EPOLL_count << " busy poll hits=" << stats.BUSY_POLL_HIT_count
+		          << " misses=" << stats.BUSY_POLL_MISS_count << std::endl;
+		stats.print_histograms(std::cout);
+		crab::RunLoop::current()->cancel();
+	}
+	crab::Watcher ab;
+	crab::Timer stop_timer;
+	std::vector<Slot> slots;
+	crab::RunLoop *loop;
+	bool use_post;
+	std::vector<std::thread> producers;
+	std::atomic<bool> quit{false};
+	steady_clock::time_point start;
+	size_t on_call_count = 0;
+	std::vector<steady_clock::duration::rep> latencies;
+};
+
 int main(int argc, char *argv[]) {
 	std::cout << "crablib version " << crab::version_string() << std::endl;
 
 	crab::RunLoop runloop;
-	TestAsyncCallsApp app;
 	std::unique_ptr<crab::Idle> idle;
-	if (argc == 2 && std::string(argv[1]) == "--idle") {
-		std::cout << "Testing with on_idle, use thread pinning for best results" << std::endl;
-		idle.reset(new crab::Idle(([]() {})));
+	size_t producers = 0;
+	bool use_post    = false;
+	for (int i = 1; i < argc; ++i) {
+		if (std::string(argv[i]) == "--idle") {
+			std::cout << "Testing with on_idle, use thread pinning for best results" << std::endl;
+			idle.reset(new crab::Idle(([]() {})));
+		}
+		if (std::string(argv[i]) == "--producers" && i + 1 < argc)
+			producers = std::stoull(argv[++i]);
+		if (std::string(argv[i]) == "--post")
+			use_post = true;
+		if (std::string(argv[i]) == "--busy-poll" && i + 1 < argc) {
+			const auto spin = std::chrono::microseconds(std::stoull(argv[++i]));
+			std::cout << "Testing with busy poll for " << spin.count() << " mksec" << std::endl;
+			runloop.set_busy_poll(spin);
+		}
 	}
+	if (producers != 0) {
+		std::cout << "Measuring throughput and latency with " << producers << " producer threads" << std::endl;
+		WatcherThroughputApp app(producers, 5, use_post);
+		runloop.run();
+		return 0;
+	}
+	std::cout << "Use --producers <N> [--post] to measure throughput and latency percentiles of Watcher::call() [RunLoop::post()]"
+	          << std::endl;
+	std::cout << "Use --busy-poll <mksec> to spin before sleeping" << std::endl;
+	TestAsyncCallsApp app;
 	runloop.run();
 	return 0;
 }
@@ -3,11 +3,13 @@
 
 #pragma once
 
+#include "dns_stub.hxx"
 #include "network.hxx"
 #include "network_boost.hxx"
 #include "network_cf.hxx"
 #include "network_libev.hxx"
 #include "network_posix_win.hxx"
+#include "slab_pool.hxx"
 #include "streams.hxx"
 #include "util.hxx"
 
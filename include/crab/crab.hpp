@@ -4,6 +4,7 @@
 #pragma once
 
 #include "crab_version.hpp"
+#include "dns_stub.hpp"
 #include "http/client_request.hpp"
 #include "http/server.hpp"
 #include "integer_cast.hpp"
@@ -7,10 +7,15 @@
 
 // #define CRAB_COMPILE 1 <- Set this in project settings to select compiled version of lib
 // #define CRAB_TLS 1     <- Set this in project settings to add TLS support (via OpenSSL or native platform support)
+// #define CRAB_TIMER_WHEEL 1 <- Set this in project settings to keep timers in hierarchical wheel instead of heap (O(1) set/cancel)
+// #define CRAB_TRACING 1 <- Set this in project settings to record RunLoop events into PerformanceStats ring
+// #define CRAB_TSC_CLOCK 1 <- Set this in project settings to make RunLoop use FastClock (calibrated TSC) where possible
 
 // #define CRAB_IMPL_LIBEV 1 <- Set this in project settings to make crab a wrapper around libev
 // #define CRAB_IMPL_BOOST 1 <- Set this in project settings to make crab a wrapper around boost::asio
 // #define CRAB_IMPL_CF 1    <- Set this in project settings to make crab a wrapper around CFRunLoop (mostly for iOS)
+// #define CRAB_IMPL_URING 1 <- Set this in project settings to use io_uring poll instead of epoll on Linux (5.13+ kernel required)
+// Experimental, only readiness goes through ring, I/O calls are the same as with epoll, so expect no throughput gain
 
 // Our selector of low-level implementation
 
@@ -27,6 +32,8 @@
     #define CRAB_IMPL_STRING "Core Foundation"
     #include <CFNetwork/CFNetwork.h>
     #include <CoreFoundation/CoreFoundation.h>
+#elif defined(__linux__) && CRAB_IMPL_URING  // Define in CMakeLists to select this impl
+    #define CRAB_IMPL_STRING "io_uring poll (experimental)"
 #elif defined(__MACH__)
     #define CRAB_IMPL_KEVENT 1
     #define CRAB_IMPL_STRING "kevent"
@@ -0,0 +1,70 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "network.hpp"
+
+namespace crab {
+
+namespace details {
+struct DNSStubSettings {
+	std::vector<Address> servers;  // empty means nameservers from resolv.conf, 127.0.0.1:53 if there are none
+	double timeout_sec = 0;        // per attempt, 0 means from resolv.conf options, 5 if not set there (like glibc)
+	size_t attempts    = 0;        // rounds over all servers, 0 means from resolv.conf options, 2 if not set there
+	bool use_hosts     = true;     // look into /etc/hosts before sending queries
+};
+}  // namespace details
+
+// Optional replacement of DNSResolver without threads. Reads /etc/resolv.conf and /etc/hosts once per process,
+// then sends A and AAAA queries over UDPTransmitter from the loop, retrying over servers on Timer.
+// Names are queried as given, search domains are not supported. TCP fallback is not implemented yet, so
+// truncated response (TC bit set) is treated as failed attempt, and next server is tried.
+class DNSStubResolver {
+public:
+	typedef DNSResolver::DNS_handler DNS_handler;
+	using Settings = details::DNSStubSettings;
+
+	explicit DNSStubResolver(DNS_handler &&handler, const Settings &settings = Settings{});
+	~DNSStubResolver() { cancel(); }
+
+	void resolve(const std::string &host_name, uint16_t port, bool ipv4, bool ipv6);  // will call handler once
+	bool is_open() const { return resolving; }
+	void cancel();
+
+	enum { TYPE_A = 1, TYPE_AAAA = 28, RCODE_NOERROR = 0, RCODE_NXDOMAIN = 3, DNS_PORT = 53, MAX_UDP_MESSAGE = 512 };
+	enum { RCODE_TRUNCATED = -1 };  // Not a real RCODE, set by parse_response for TC bit
+
+	// RFC 1035 messages, public for tests. build_query returns false for invalid names
+	static bool build_query(std::vector<uint8_t> &query, uint16_t id, const std::string &host_name, uint16_t qtype);
+	static bool parse_response(const uint8_t *data, size_t size, const std::vector<uint8_t> &query, uint16_t port,
+	    std::vector<Address> &names, int &rcode);
+	// returns false if datagram is not a response to query, otherwise appends A or AAAA records (with port) to names.
+	// For truncated response, rcode is RCODE_TRUNCATED and records are not appended
+
+private:
+	struct Query {
+		std::vector<uint8_t> message;
+		bool done = false;
+	};
+	void start_attempt();
+	void on_socket();
+	void on_timer();
+	bool all_done() const;
+
+	DNS_handler dns_handler;
+	Settings settings;
+	std::unique_ptr<UDPTransmitter> socket;  // new socket (and source port) for each attempt
+	Timer timer;                             // attempt timeout, also used to call handler not from resolve()
+
+	bool resolving = false;
+	uint16_t port  = 0;
+	size_t attempt = 0;
+	std::vector<Query> queries;
+	std::vector<Address> names;
+};
+
+}  // namespace crab
@@ -0,0 +1,276 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include "dns_stub.hpp"
+
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace crab {
+
+namespace details {
+
+struct DNSStubConfig {
+	std::vector<Address> servers;
+	double timeout_sec = 5;
+	size_t attempts    = 2;
+	std::multimap<std::string, std::string> hosts;  // lowercase name -> ip
+
+	static std::string to_lower(std::string str) {
+		for (auto &c : str)
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		return str;
+	}
+	static const DNSStubConfig &get_instance() {
+		// C++11 local static variables are thread-safe
+		static const DNSStubConfig instance("/etc/resolv.conf", "/etc/hosts");
+		return instance;
+	}
+	DNSStubConfig(const char *resolv_conf_path, const char *hosts_path) {
+		std::ifstream resolv_conf(resolv_conf_path);
+		std::string line;
+		while (std::getline(resolv_conf, line)) {
+			std::istringstream ss(line);
+			std::string word;
+			ss >> word;
+			if (word == "nameserver") {
+				Address address;
+				if (ss >> word && Address::parse(address, word, DNSStubResolver::DNS_PORT))
+					servers.push_back(address);  // Link-local IPv6 with %scope are skipped
+				continue;
+			}
+			if (word != "options")
+				continue;
+			while (ss >> word) {
+				if (word.compare(0, 8, "timeout:") == 0)
+					timeout_sec = std::max(1, std::atoi(word.c_str() + 8));
+				if (word.compare(0, 9, "attempts:") == 0)
+					attempts = std::max(1, std::atoi(word.c_str() + 9));
+			}
+		}
+		if (servers.empty())
+			servers.push_back(Address("127.0.0.1", DNSStubResolver::DNS_PORT));
+		std::ifstream hosts_file(hosts_path);
+		while (std::getline(hosts_file, line)) {
+			std::istringstream ss(line.substr(0, line.find('#')));
+			std::string ip;
+			std::string name;
+			if (!(ss >> ip))
+				continue;
+			while (ss >> name)
+				hosts.emplace(to_lower(name), ip);
+		}
+	}
+};
+
+inline void dns_put_u16(std::vector<uint8_t> &data, uint16_t value) {
+	data.push_back(static_cast<uint8_t>(value >> 8));
+	data.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint16_t dns_get_u16(const uint8_t *data) { return static_cast<uint16_t>((data[0] << 8) | data[1]); }
+
+inline bool dns_skip_name(const uint8_t *data, size_t size, size_t &pos) {
+	while (pos < size) {
+		const uint8_t len = data[pos];
+		if (len == 0) {
+			pos += 1;
+			return true;
+		}
+		if ((len & 0xC0) == 0xC0) {  // Compression pointer ends name
+			pos += 2;
+			return pos <= size;
+		}
+		if ((len & 0xC0) != 0)
+			return false;
+		pos += 1 + len;
+	}
+	return false;
+}
+
+}  // namespace details
+
+CRAB_INLINE bool DNSStubResolver::build_query(std::vector<uint8_t> &query, uint16_t id, const std::string &host_name, uint16_t qtype) {
+	query.clear();
+	details::dns_put_u16(query, id);
+	details::dns_put_u16(query, 0x0100);  // Standard query, recursion desired
+	details::dns_put_u16(query, 1);       // QDCOUNT
+	details::dns_put_u16(query, 0);
+	details::dns_put_u16(query, 0);
+	details::dns_put_u16(query, 0);
+	size_t start = 0;
+	while (start < host_name.size()) {
+		size_t end = host_name.find('.', start);
+		if (end == std::string::npos)
+			end = host_name.size();
+		const size_t len = end - start;
+		if (len == 0 || len > 63)
+			return false;
+		query.push_back(static_cast<uint8_t>(len));
+		query.insert(query.end(), host_name.begin() + start, host_name.begin() + end);
+		start = end + 1;  // Trailing dot is allowed
+	}
+	query.push_back(0);
+	if (query.size() - 12 > 255 || query.size() == 13)  // Name length limit, empty name
+		return false;
+	details::dns_put_u16(query, qtype);
+	details::dns_put_u16(query, 1);  // QCLASS IN
+	return true;
+}
+
+CRAB_INLINE bool DNSStubResolver::parse_response(const uint8_t *data, size_t size, const std::vector<uint8_t> &query,
+    uint16_t port, std::vector<Address> &names, int &rcode) {
+	if (size < query.size() || data[0] != query[0] || data[1] != query[1])
+		return false;
+	if ((data[2] & 0x80) == 0 || (data[2] & 0x78) != 0 || details::dns_get_u16(data + 4) != 1)
+		return false;  // Not a response, not a standard query, or not a single question
+	for (size_t i = 12; i != query.size(); ++i)  // Question must be ours, servers can change case of name
+		if (std::tolower(data[i]) != std::tolower(query[i]))
+			return false;
+	if ((data[2] & 0x02) != 0) {  // TC, answer can be partial, we have no TCP fallback, so must not use it
+		rcode = RCODE_TRUNCATED;
+		return true;
+	}
+	rcode                = data[3] & 0x0F;
+	const uint16_t qtype = details::dns_get_u16(query.data() + query.size() - 4);
+	const size_t ancount = details::dns_get_u16(data + 6);
+	size_t pos           = query.size();
+	for (size_t i = 0; i != ancount; ++i) {  // Records of CNAME chain are skipped, we take all addresses
+		if (!details::dns_skip_name(data, size, pos) || pos + 10 > size)
+			break;  // Truncated message, we take what we have
+		const uint16_t type  = details::dns_get_u16(data + pos);
+		const uint16_t klass = details::dns_get_u16(data + pos + 2);
+		const size_t rdlen   = details::dns_get_u16(data + pos + 8);
+		pos += 10;
+		if (pos + rdlen > size)
+			break;
+		if (klass == 1 && type == qtype && type == TYPE_A && rdlen == 4) {
+			names.emplace_back();
+			auto sa        = reinterpret_cast<sockaddr_in *>(names.back().impl_get_sockaddr());
+			sa->sin_family = AF_INET;
+			sa->sin_port   = htons(port);
+			std::memcpy(&sa->sin_addr, data + pos, 4);
+		}
+		if (klass == 1 && type == qtype && type == TYPE_AAAA && rdlen == 16) {
+			names.emplace_back();
+			auto sa         = reinterpret_cast<sockaddr_in6 *>(names.back().impl_get_sockaddr());
+			sa->sin6_family = AF_INET6;
+			sa->sin6_port   = htons(port);
+			std::memcpy(&sa->sin6_addr, data + pos, 16);
+		}
+		pos += rdlen;
+	}
+	return true;
+}
+
+CRAB_INLINE DNSStubResolver::DNSStubResolver(DNS_handler &&handler, const Settings &settings)
+    : dns_handler(std::move(handler)), settings(settings), timer([this]() { on_timer(); }) {
+	const auto &config = details::DNSStubConfig::get_instance();
+	if (this->settings.servers.empty())
+		this->settings.servers = config.servers;
+	if (this->settings.timeout_sec <= 0)
+		this->settings.timeout_sec = config.timeout_sec;
+	if (this->settings.attempts == 0)
+		this->settings.attempts = config.attempts;
+}
+
+CRAB_INLINE void DNSStubResolver::resolve(const std::string &host_name, uint16_t port, bool ipv4, bool ipv6) {
+	cancel();
+	resolving  = true;
+	this->port = port;
+	attempt    = 0;
+	Address literal;
+	if (Address::parse(literal, host_name, port)) {
+		names.push_back(literal);
+		return timer.once(0);  // Handler must not be called from resolve()
+	}
+	if (settings.use_hosts) {
+		const auto range = details::DNSStubConfig::get_instance().hosts.equal_range(details::DNSStubConfig::to_lower(host_name));
+		for (auto it = range.first; it != range.second; ++it) {
+			Address address;
+			if (Address::parse(address, it->second, port) && (address.impl_get_sockaddr()->sa_family == AF_INET ? ipv4 : ipv6))
+				names.push_back(address);
+		}
+		if (!names.empty())
+			return timer.once(0);
+	}
+	for (uint16_t qtype : {uint16_t(TYPE_A), uint16_t(TYPE_AAAA)}) {
+		if ((qtype == TYPE_A && !ipv4) || (qtype == TYPE_AAAA && !ipv6))
+			continue;
+		queries.emplace_back();
+		if (!build_query(queries.back().message, RunLoop::current()->rnd.pod<uint16_t>(), host_name, qtype)) {
+			queries.clear();
+			return timer.once(0);  // Invalid name, nothing to send
+		}
+	}
+	if (queries.empty())
+		return timer.once(0);
+	start_attempt();
+}
+
+CRAB_INLINE void DNSStubResolver::cancel() {
+	resolving = false;
+	timer.cancel();
+	socket.reset();
+	queries.clear();
+	names.clear();
+}
+
+CRAB_INLINE bool DNSStubResolver::all_done() const {
+	for (const auto &q : queries)
+		if (!q.done)
+			return false;
+	return true;
+}
+
+CRAB_INLINE void DNSStubResolver::start_attempt() {
+	const Address &server = settings.servers.at(attempt % settings.servers.size());
+	socket.reset(new UDPTransmitter(server, [this]() { on_socket(); }));
+	for (const auto &q : queries)
+		if (!q.done)
+			socket->write_datagram(q.message.data(), q.message.size());  // Fresh socket, will not be full
+	timer.once(settings.timeout_sec);
+}
+
+CRAB_INLINE void DNSStubResolver::on_socket() {
+	uint8_t buffer[MAX_UDP_MESSAGE];
+	while (resolving) {
+		const auto count = socket->read_datagram(buffer, sizeof(buffer));
+		if (!count)
+			break;
+		for (auto &q : queries) {
+			int rcode = 0;
+			if (q.done || !parse_response(buffer, std::min(*count, sizeof(buffer)), q.message, port, names, rcode))
+				continue;
+			if (rcode == RCODE_NOERROR || rcode == RCODE_NXDOMAIN) {
+				q.done = true;
+				if (all_done())
+					timer.once(0);
+			} else {
+				timer.once(0);  // SERVFAIL, REFUSED, truncated, etc. - next server right away
+			}
+		}
+	}
+}
+
+CRAB_INLINE void DNSStubResolver::on_timer() {
+	if (!all_done() && ++attempt < settings.servers.size() * settings.attempts)
+		return start_attempt();  // Socket is not destroyed from its own handler
+	resolving   = false;
+	auto result = std::move(names);  // Handler can call resolve()
+	names.clear();
+	queries.clear();
+	dns_handler(result);
+}
+
+}  // namespace crab
+
+#endif
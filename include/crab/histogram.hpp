@@ -0,0 +1,97 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+// Log-linear histogram, approach similar to HdrHistogram by Gil Tene
+// https://github.com/HdrHistogram/HdrHistogram
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "util.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace crab {
+
+// Fixed memory, record() is O(1) without allocations and locks. Values below SUB_BUCKETS are exact,
+// others land in bucket with relative width 1/SUB_BUCKETS. Single writer thread, but snapshot()
+// can be taken from any thread, so that histograms can be exported while loop is running.
+
+class Histogram : private Nocopy {
+public:
+	enum { SUB_BITS = 3, SUB_BUCKETS = 1 << SUB_BITS, BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS };
+
+	void record(uint64_t value) {  // from writer thread
+		auto &counter = counts[bucket(value)];
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	void clear() {  // from writer thread
+		for (auto &counter : counts)
+			counter.store(0, std::memory_order_relaxed);
+	}
+
+	struct Snapshot {
+		std::vector<uint64_t> counts;  // BUCKETS elements
+		uint64_t total = 0;
+
+		// Upper bound of bucket, which contains requested percentile, 0 if empty. p in [0..1]
+		uint64_t percentile(double p) const {
+			if (total == 0)
+				return 0;
+			const auto rank = static_cast<uint64_t>(p * double(total - 1)) + 1;
+			uint64_t seen   = 0;
+			for (size_t i = 0; i != counts.size(); ++i) {
+				seen += counts[i];
+				if (seen >= rank)
+					return bucket_upper(i);
+			}
+			return bucket_upper(counts.size() - 1);
+		}
+		uint64_t max_value() const { return percentile(1); }
+	};
+	Snapshot snapshot() const {
+		Snapshot result;
+		result.counts.resize(BUCKETS);
+		for (size_t i = 0; i != BUCKETS; ++i) {
+			result.counts[i] = counts[i].load(std::memory_order_relaxed);
+			result.total += result.counts[i];
+		}
+		return result;
+	}
+
+	static size_t bucket(uint64_t value) {
+		if (value < SUB_BUCKETS)
+			return static_cast<size_t>(value);
+		const size_t shift = highest_bit(value) - SUB_BITS;
+		return shift * SUB_BUCKETS + static_cast<size_t>(value >> shift);  // value >> shift is in [SUB_BUCKETS..2*SUB_BUCKETS)
+	}
+	static uint64_t bucket_lower(size_t index) {
+		if (index < 2 * SUB_BUCKETS)
+			return index;
+		const size_t shift = index / SUB_BUCKETS - 1;
+		return uint64_t(index - shift * SUB_BUCKETS) << shift;
+	}
+	static uint64_t bucket_upper(size_t index) {
+		return index + 1 == BUCKETS ? std::numeric_limits<uint64_t>::max() : bucket_lower(index + 1) - 1;
+	}
+
+private:
+	std::atomic<uint64_t> counts[BUCKETS]{};
+
+	static size_t highest_bit(uint64_t value) {  // value != 0
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+};
+
+}  // namespace crab
@@ -54,25 +54,62 @@ public:
 	void write(std::string &&ss, BufferOptions bo = WRITE);
 	void buffer(std::string &&ss);
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+	void write_file(std::shared_ptr<const details::FileDescriptor> file, uint64_t offset, size_t count, BufferOptions bo = WRITE);
+	// Range of file is sent with TCPSocket::write_file (from page cache) after data before it, file is kept open
+	// until then. If file becomes shorter than offset + count, socket is closed, because we cannot send promised bytes
+#endif
+
+	void set_zerocopy_threshold(size_t threshold) { zerocopy_threshold = threshold; }
+	// Strings passed to write(std::string &&) and buffer(std::string &&) of threshold size or larger are sent
+	// without copying into kernel (Linux MSG_ZEROCOPY), 0 (default) disables. Recommended ZEROCOPY_THRESHOLD or more.
+
 	void write_shutdown();
 
 	size_t get_total_buffer_size() const { return total_data_to_write; }
 
-	enum { WM_SHUTDOWN_TIMEOUT_SEC = 15 };
+	enum { WM_SHUTDOWN_TIMEOUT_SEC = 15, ZEROCOPY_THRESHOLD = 65536, COPY_CHUNK_CAPACITY = 4096 };
 
 protected:
-	std::deque<StringStream> data_to_write;
+	// Whole queue is sent with single vectored write, so moved-in strings are never merged (copied) together.
+	// Only data passed by pointer is copied, into the last chunk if it has enough capacity
+	struct WriteChunk {
+		std::string data;
+		std::shared_ptr<const std::string> pinned;  // instead of data, if large, owned together with socket until kernel sends it
+		size_t pos = 0;
+
+		explicit WriteChunk(std::string &&ss) : data(std::move(ss)) {}
+		explicit WriteChunk(std::shared_ptr<const std::string> &&ss) : pinned(std::move(ss)) {}
+		const std::string &get() const { return pinned ? *pinned : data; }
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+		std::shared_ptr<const details::FileDescriptor> file;  // instead of data, range is sent alone with sendfile
+		uint64_t file_offset = 0;
+		size_t file_size     = 0;
+
+		WriteChunk(std::shared_ptr<const details::FileDescriptor> &&file, uint64_t offset, size_t size)
+		    : file(std::move(file)), file_offset(offset), file_size(size) {}
+		size_t size() const { return file ? file_size : get().size(); }
+		bool appendable() const { return !pinned && !file; }
+#else
+		size_t size() const { return get().size(); }
+		bool appendable() const { return !pinned; }
+#endif
+	};
+	std::deque<WriteChunk> data_to_write;
+	std::vector<ConstSlice> slices;  // Reused between writes
 	size_t total_data_to_write = 0;
+	size_t zerocopy_threshold  = 0;
 	bool write_shutdown_asked  = false;
 
 	void write();
+	void consume(size_t count);
 	void sock_handler();
 	void shutdown_timer_handler();
 
 	Handler rwd_handler;
 
 	TCPSocketTLS sock;
-	Timer shutdown_timer;
+	Deadline shutdown_timer;
 };
 
 namespace http {
@@ -176,6 +213,12 @@ public:
 #endif
 	void write(std::string &&ss, BufferOptions bo = WRITE);  // Write body chunk
 	void write_last_chunk(BufferOptions bo = WRITE);         // for chunk encoding and multiframe web messages, finishes body
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+	void write_file(std::shared_ptr<const details::FileDescriptor> file, uint64_t offset, size_t count, BufferOptions bo = WRITE);
+	// Write body chunk from file with sendfile, for body with content_length only
+#endif
+	void write_head(ResponseHeader &resp, BufferOptions bo = WRITE);
+	// Write header without body (response to HEAD, 304), content_length is sent as is, finishes response
 
 	enum State {
 		REQUEST_HEADER,   // Reading header
@@ -209,7 +252,7 @@ protected:
 	WebMessageHeaderParser wm_header_parser;  // Chunk header
 	WebMessageBodyParser wm_body_parser;      // Chunk body
 	optional<WebMessage> web_message;         // Built from chunks
-	Timer wm_ping_timer;
+	Deadline wm_ping_timer;
 	// Server-side ping required for some NATs to keep port open
 	// TCP keep-alive is set by most browsers, but surprisingly it is not enough.
 	// We reset this timer on write() only
@@ -219,6 +262,7 @@ protected:
 	void sock_handler();
 	void on_wm_ping_timer();
 	bool advance_state();
+	void finish_response();
 
 	Handler rwd_handler;
 
@@ -6,6 +6,10 @@
 #include <sstream>
 #include "connection.hpp"
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+#include <sys/stat.h>
+#endif
+
 namespace crab {
 
 namespace details {
@@ -26,7 +30,9 @@ CRAB_INLINE std::string web_message_create_close_body(const std::string &reason,
 }  // namespace details
 
 CRAB_INLINE BufferedTCPSocket::BufferedTCPSocket(Handler &&rwd_handler)
-    : rwd_handler(std::move(rwd_handler)), sock([this]() { sock_handler(); }), shutdown_timer([this]() { shutdown_timer_handler(); }) {}
+    : rwd_handler(std::move(rwd_handler))
+    , sock([this]() { sock_handler(); })
+    , shutdown_timer(std::chrono::seconds(WM_SHUTDOWN_TIMEOUT_SEC), [this]() { shutdown_timer_handler(); }) {}
 
 CRAB_INLINE void BufferedTCPSocket::close(bool with_event) {
 	shutdown_timer.cancel();
@@ -52,18 +58,24 @@ CRAB_INLINE void BufferedTCPSocket::buffer(const uint8_t *val, size_t count) {
 	if (!sock.is_open() || write_shutdown_asked || count == 0)
 		return;
 	total_data_to_write += count;
-	if (!data_to_write.empty() && data_to_write.back().size() < 1024 && count < 1024)  // TODO - constant
-		data_to_write.back().write(val, count);
-	else
-		data_to_write.emplace_back(std::string(reinterpret_cast<const char *>(val), count));
+	const char *str = reinterpret_cast<const char *>(val);
+	if (!data_to_write.empty() && data_to_write.back().appendable() &&
+	    data_to_write.back().data.capacity() - data_to_write.back().data.size() >= count) {
+		data_to_write.back().data.append(str, count);  // Without reallocation, so previous data is not copied again
+		return;
+	}
+	std::string ss;
+	ss.reserve(std::max<size_t>(count, COPY_CHUNK_CAPACITY));
+	ss.append(str, count);
+	data_to_write.emplace_back(std::move(ss));
 }
 
 CRAB_INLINE void BufferedTCPSocket::buffer(std::string &&ss) {
 	if (!sock.is_open() || write_shutdown_asked || ss.empty())
 		return;
 	total_data_to_write += ss.size();
-	if (!data_to_write.empty() && data_to_write.back().size() < 1024 && ss.size() < 1024)  // TODO - constant
-		data_to_write.back().write(ss.data(), ss.size());
+	if (zerocopy_threshold != 0 && ss.size() >= zerocopy_threshold)
+		data_to_write.emplace_back(std::make_shared<const std::string>(std::move(ss)));
 	else
 		data_to_write.emplace_back(std::move(ss));
 }
@@ -88,32 +100,103 @@ CRAB_INLINE void BufferedTCPSocket::write(std::string &&ss, BufferOptions bo) {
 		write();
 }
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+CRAB_INLINE void BufferedTCPSocket::write_file(std::shared_ptr<const details::FileDescriptor> file, uint64_t offset, size_t count,
+    BufferOptions bo) {
+	if (!sock.is_open() || write_shutdown_asked)
+		return;
+	if (count != 0) {
+		total_data_to_write += count;
+		data_to_write.emplace_back(std::move(file), offset, count);
+	}
+	if (bo != BUFFER_ONLY)
+		write();
+}
+#endif
+
 CRAB_INLINE void BufferedTCPSocket::write_shutdown() {
 	if (!sock.is_open() || write_shutdown_asked)
 		return;
 	write_shutdown_asked = true;
 	if (data_to_write.empty()) {
 		sock.write_shutdown();
-		shutdown_timer.once(WM_SHUTDOWN_TIMEOUT_SEC);
+		shutdown_timer.arm();
 	}
 }
 
 CRAB_INLINE void BufferedTCPSocket::write() {
 	bool was_empty = data_to_write.empty();
 	while (!data_to_write.empty()) {
-		total_data_to_write -= data_to_write.front().write_to(sock);
-		if (!data_to_write.front().empty())
+		size_t count = 0;
+		size_t wr    = 0;
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+		const auto &front = data_to_write.front();
+		if (front.file) {
+			count = front.file_size - front.pos;
+			wr    = sock.write_file(front.file->get_value(), front.file_offset + front.pos, count);
+			if (wr == 0 && sock.is_open() && sock.can_write()) {
+				// Either file was truncated (sendfile returns 0 at end of file), or TLS engine cannot write yet
+				struct ::stat st {};
+				if (::fstat(front.file->get_value(), &st) != 0 || uint64_t(st.st_size) < front.file_offset + front.file_size)
+					return close(true);
+				return;
+			}
+		} else
+#endif
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+		if (front.pinned) {  // Each zero-copy send holds single chunk
+			count = front.pinned->size() - front.pos;
+			wr    = sock.write_zerocopy(uint8_cast(front.pinned->data()) + front.pos, count, front.pinned);
+		} else
+#endif
+		{
+			slices.clear();
+			for (const auto &chunk : data_to_write) {
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+				if (chunk.file)
+					break;
+#endif
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+				if (chunk.pinned)
+					break;
+#endif
+				if (slices.size() == TCPSocket::MAX_SLICES)
+					break;
+				const auto &str = chunk.get();
+				slices.push_back(ConstSlice{uint8_cast(str.data()) + chunk.pos, str.size() - chunk.pos});
+				count += str.size() - chunk.pos;
+			}
+			wr = sock.write_some(slices.data(), slices.size());
+		}
+		consume(wr);
+		if (wr != count)
 			break;
-		data_to_write.pop_front();
 	}
 	if (write_shutdown_asked && data_to_write.empty() && !was_empty) {
 		sock.write_shutdown();
-		shutdown_timer.once(WM_SHUTDOWN_TIMEOUT_SEC);
+		shutdown_timer.arm();
+	}
+}
+
+CRAB_INLINE void BufferedTCPSocket::consume(size_t count) {
+	total_data_to_write -= count;
+	while (count != 0) {
+		auto &chunk       = data_to_write.front();
+		const size_t left = chunk.size() - chunk.pos;
+		if (count < left) {
+			chunk.pos += count;
+			return;
+		}
+		count -= left;
+		data_to_write.pop_front();
 	}
 }
 
 CRAB_INLINE void BufferedTCPSocket::sock_handler() {
 	if (sock.is_open()) {
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+		sock.read_zerocopy_completions();  // User might not read
+#endif
 		write();
 		if (write_shutdown_asked && data_to_write.empty()) {
 			// Now after FIN sent, we consume and discard a bit of received data.
@@ -424,7 +507,7 @@ CRAB_INLINE bool ClientConnection::advance_state() {
 
 CRAB_INLINE ServerConnection::ServerConnection(Handler &&rwd_handler)
     : read_buffer(8192)
-    , wm_ping_timer([&]() { on_wm_ping_timer(); })
+    , wm_ping_timer(std::chrono::seconds(WM_PING_TIMEOUT_SEC), [&]() { on_wm_ping_timer(); })
     , rwd_handler(std::move(rwd_handler))
     , sock([this]() { sock_handler(); }) {}
 
@@ -493,7 +576,7 @@ CRAB_INLINE void ServerConnection::web_socket_upgrade() {
 	wm_header_parser = WebMessageHeaderParser{};
 	wm_body_parser   = WebMessageBodyParser{};
 	state            = WEB_MESSAGE_HEADER;
-	wm_ping_timer.once(WM_PING_TIMEOUT_SEC);  // Always server-side
+	wm_ping_timer.arm();  // Always server-side
 }
 
 CRAB_INLINE void ServerConnection::write(Response &&resp) {
@@ -524,6 +607,13 @@ CRAB_INLINE void ServerConnection::write(ResponseHeader &resp, BufferOptions bo)
 	state = RESPONSE_BODY;
 }
 
+CRAB_INLINE void ServerConnection::write_head(ResponseHeader &resp, BufferOptions bo) {
+	if (!is_open())
+		return;  // This NOP simplifies state machines of connection users
+	write(resp, bo);
+	finish_response();
+}
+
 CRAB_INLINE void ServerConnection::write(WebMessage &&message, BufferOptions bo) {
 	if (!is_open())
 		return;  // This NOP simplifies state machines of connection users
@@ -551,7 +641,7 @@ CRAB_INLINE void ServerConnection::write(WebMessage &&message, BufferOptions bo)
 		return;
 	}
 	if (bo == BufferOptions::WRITE)
-		wm_ping_timer.once(WM_PING_TIMEOUT_SEC);
+		wm_ping_timer.arm();
 }
 
 CRAB_INLINE void ServerConnection::write(WebMessageOpcode opcode) {
@@ -578,7 +668,7 @@ CRAB_INLINE void ServerConnection::write(const uint8_t *val, size_t count, Buffe
 		sock.buffer(header.data(), header.size());
 		sock.write(val, count, bo);
 		if (bo == BufferOptions::WRITE)
-			wm_ping_timer.once(WM_PING_TIMEOUT_SEC);
+			wm_ping_timer.arm();
 		return;
 	}
 	if (remaining_body_content_length) {
@@ -586,12 +676,7 @@ CRAB_INLINE void ServerConnection::write(const uint8_t *val, size_t count, Buffe
 		*remaining_body_content_length -= count;
 		sock.write(val, count, bo);
 		if (*remaining_body_content_length == 0) {
-			if (!request_parser.req.keep_alive) {  // We sent it in our response header
-				read_buffer.clear();
-				sock.write_shutdown();
-			}
-			request_parser = RequestParser{};
-			state          = REQUEST_HEADER;
+			finish_response();
 		}
 		return;
 	}
@@ -614,7 +699,7 @@ CRAB_INLINE void ServerConnection::write(std::string &&ss, BufferOptions bo) {
 		sock.buffer(header.data(), header.size());
 		sock.write(std::move(ss), bo);
 		if (bo == BufferOptions::WRITE)
-			wm_ping_timer.once(WM_PING_TIMEOUT_SEC);
+			wm_ping_timer.arm();
 		return;
 	}
 	if (remaining_body_content_length) {
@@ -622,12 +707,7 @@ CRAB_INLINE void ServerConnection::write(std::string &&ss, BufferOptions bo) {
 		*remaining_body_content_length -= ss.size();
 		sock.write(std::move(ss), bo);
 		if (*remaining_body_content_length == 0) {
-			if (!request_parser.req.keep_alive) {  // We sent it in our response header
-				read_buffer.clear();
-				sock.write_shutdown();
-			}
-			request_parser = RequestParser{};
-			state          = REQUEST_HEADER;
+			finish_response();
 		}
 		return;
 	}
@@ -641,19 +721,35 @@ CRAB_INLINE void ServerConnection::write(std::string &&ss, BufferOptions bo) {
 	sock.write("\r\n", 2, bo);
 }
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+CRAB_INLINE void ServerConnection::write_file(std::shared_ptr<const details::FileDescriptor> file, uint64_t offset, size_t count,
+    BufferOptions bo) {
+	invariant(state == RESPONSE_BODY && remaining_body_content_length, "write_file is for body with content_length only");
+	invariant(count <= *remaining_body_content_length, "Overshoot content-length");
+	*remaining_body_content_length -= count;
+	sock.write_file(std::move(file), offset, count, bo);
+	if (*remaining_body_content_length == 0)
+		finish_response();
+}
+#endif
+
 CRAB_INLINE void ServerConnection::write_last_chunk(BufferOptions bo) {
 	invariant(is_writing_body(), "Connection unexpected write");
 	if (writing_web_message_body) {
 		WebMessageHeaderSaver header{true, 0, 0, {}};
 		sock.write(header.data(), header.size(), bo);
 		if (bo == BufferOptions::WRITE)
-			wm_ping_timer.once(WM_PING_TIMEOUT_SEC);
+			wm_ping_timer.arm();
 		writing_web_message_body = false;
 		return;
 	}
 	invariant(state == RESPONSE_BODY, "Connection unexpected write");
 	invariant(!remaining_body_content_length, "write_last_chunk is for chunked encoding only");
 	sock.write(std::string{"0\r\n\r\n"}, bo);
+	finish_response();
+}
+
+CRAB_INLINE void ServerConnection::finish_response() {
 	if (!request_parser.req.keep_alive) {  // We sent it in our response header
 		read_buffer.clear();
 		sock.write_shutdown();
@@ -683,7 +779,7 @@ CRAB_INLINE void ServerConnection::on_wm_ping_timer() {
 		sock.write(std::string{});  // Flushing buffer is enough
 	else
 		write(WebMessage{WebMessageOpcode::PING, std::string{}});
-	wm_ping_timer.once(WM_PING_TIMEOUT_SEC);
+	wm_ping_timer.arm();
 }
 
 CRAB_INLINE bool ServerConnection::advance_state() {
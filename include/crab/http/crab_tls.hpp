@@ -118,6 +118,26 @@ public:
 		return result;
 	}
 	using OStream::write_some;  // Version for other char types
+	size_t write_some(const ConstSlice *slices, size_t count) override {
+		if (!tls_engine)
+			return sock.write_some(slices, count);
+		return OStream::write_some(slices, count);  // Engine collects records anyway, so no gain from gathering
+	}
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+	size_t write_file(int file_fd, uint64_t offset, size_t count) {
+		if (!tls_engine)
+			return sock.write_file(file_fd, offset, count);
+		return write_file_copy(file_fd, offset, count);  // Must be encrypted, so no sendfile
+	}
+#endif
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	size_t write_zerocopy(const uint8_t *val, size_t count, std::shared_ptr<const void> holder) {
+		if (!tls_engine)
+			return sock.write_zerocopy(val, count, std::move(holder));
+		return write_some(val, count);  // Encrypted data is already a copy
+	}
+	void read_zerocopy_completions() { sock.read_zerocopy_completions(); }
+#endif
 	bool can_write() const { return sock.can_write(); }
 	void write_shutdown() {
 		if (!tls_engine)
@@ -130,6 +150,9 @@ private:
 	TCPSocket sock;
 	Handler rwd_handler;
 	std::unique_ptr<details::TLSEngine> tls_engine;
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+	size_t write_file_copy(int file_fd, uint64_t offset, size_t count);
+#endif
 
 	void on_sock() {
 		if (tls_engine) {
@@ -6,6 +6,10 @@
 #include <sstream>
 #include "crab_tls.hpp"
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+#include <unistd.h>
+#endif
+
 #if CRAB_TLS
 
 namespace crab {
@@ -82,6 +86,18 @@ CRAB_INLINE void details::TLSEngine::read_from_socket(IStream *sock) {
 	}
 }
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+CRAB_INLINE size_t TCPSocketTLS::write_file_copy(int file_fd, uint64_t offset, size_t count) {
+	if (!sock.can_write())
+		return 0;
+	uint8_t buffer[16384];  // Uninitialized, single TLS record
+	const ssize_t rd = ::pread(file_fd, buffer, std::min(count, sizeof(buffer)), static_cast<off_t>(offset));
+	if (rd <= 0)
+		return 0;
+	return write_some(buffer, static_cast<size_t>(rd));
+}
+#endif
+
 }  // namespace crab
 
 #endif
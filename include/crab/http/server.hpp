@@ -9,6 +9,7 @@
 #include <list>
 #include <memory>
 #include <stdexcept>
+#include <unordered_map>
 #include "../network.hpp"
 #include "../util.hpp"
 #include "connection.hpp"
@@ -23,6 +24,40 @@ struct HTTPServerSettings : public TCPAcceptorSettings {
 	size_t max_connections = 131072;
 };
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+struct StaticFile {
+	FileDescriptor fd;
+	uint64_t size = 0;
+	std::string etag;           // strong, from size and modification time
+	std::string last_modified;  // HTTP-date
+	uint64_t dev = 0, ino = 0;  // To detect changes, together with size and modification time
+	int64_t mtime_ns = 0;
+};
+
+// Open files with stat results, so that serving file costs no syscalls except sendfile. Files are checked with
+// stat() at most once per STAT_INTERVAL_MS and reopened if changed (in-flight responses keep old fd open).
+// Per thread, so per loop and without locks.
+class StaticFileCache {
+public:
+	enum { MAX_FILES = 1024, STAT_INTERVAL_MS = 1000 };
+
+	std::shared_ptr<const StaticFile> open(const std::string &path);  // nullptr if not a readable regular file
+
+private:
+	struct Entry {
+		std::shared_ptr<const StaticFile> file;
+		std::chrono::steady_clock::time_point checked;
+	};
+	std::unordered_map<std::string, Entry> files;
+};
+
+// Returns status (200, 206, 304 or 416), for 206 sets [begin..end) to single range. Multiple and invalid ranges
+// are ignored (200), as allowed by RFC 7233
+int static_file_status(const http::RequestHeader &request, const StaticFile &file, uint64_t &begin, uint64_t &end);
+bool etag_list_contains(const std::string &list, const std::string &etag);  // weak comparison, "*" matches all
+bool parse_range_number(const std::string &value, size_t &pos, uint64_t &result);  // saturates, false if no digits
+#endif
+
 }  // namespace details
 
 namespace http {
@@ -72,6 +107,13 @@ public:
 	// finish streaming (should not be used if ResponseHeader contains Content-Length)
 	void write_last_chunk(BufferOptions bo = WRITE);
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+	// write the whole response from file with sendfile, handles HEAD, If-None-Match, If-Modified-Since (exact match
+	// like nginx), If-Range and single Range. Returns false and writes nothing if path is not a readable regular file.
+	// content_type is guessed from extension if empty. Files are cached open, see details::StaticFileCache
+	bool write_file(const RequestHeader &request, const std::string &path, const std::string &content_type = std::string{});
+#endif
+
 private:
 	WS_handler ws_handler;
 	Handler d_handler;
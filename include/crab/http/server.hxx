@@ -4,12 +4,20 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
+#include <limits>
 #include <iostream>
 #include "../network.hpp"
 #include "request_parser.hpp"
 #include "server.hpp"
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
 // to test
 // httperf --port 8090 --num-calls 100000 --uri /index.html
 // curl -s "http://127.0.0.1:8888/?[1-10000]"
@@ -18,7 +26,164 @@
 // wrk -t2 -c20 -d5s http://127.0.0.1:8888/index.html
 // gobench -t 5 -c 128 -u http://127.0.0.1:7000/index.html
 
-namespace crab { namespace http {
+namespace crab {
+
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+namespace details {
+
+CRAB_INLINE std::shared_ptr<const StaticFile> StaticFileCache::open(const std::string &path) {
+	const auto now = RunLoop::current()->now();
+	auto it        = files.find(path);
+	if (it != files.end() && now < it->second.checked + std::chrono::milliseconds(STAT_INTERVAL_MS))
+		return it->second.file;
+	struct ::stat st {};
+	if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+		if (it != files.end())
+			files.erase(it);
+		return nullptr;
+	}
+#if defined(__MACH__)
+	int64_t mtime_ns = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+	int64_t mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+	if (it != files.end()) {
+		const StaticFile &was = *it->second.file;
+		if (was.dev == uint64_t(st.st_dev) && was.ino == uint64_t(st.st_ino) && was.size == uint64_t(st.st_size) &&
+		    was.mtime_ns == mtime_ns) {
+			it->second.checked = now;
+			return it->second.file;
+		}
+		files.erase(it);
+	}
+	auto file = std::make_shared<StaticFile>();
+	file->fd.reset(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+	if (!file->fd.is_valid() || ::fstat(file->fd.get_value(), &st) != 0 || !S_ISREG(st.st_mode))
+		return nullptr;  // Replaced between stat and open, we will stat again on next request
+#if defined(__MACH__)
+	mtime_ns = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+	mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+	file->size     = st.st_size;
+	file->dev      = st.st_dev;
+	file->ino      = st.st_ino;
+	file->mtime_ns = mtime_ns;
+	char buf[64]{};
+	std::snprintf(buf, sizeof(buf), "\"%llx-%llx\"", (unsigned long long)file->size, (unsigned long long)mtime_ns);
+	file->etag             = buf;
+	const std::time_t time = st.st_mtime;
+	struct ::tm tm {};
+	gmtime_r(&time, &tm);
+	strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+	file->last_modified = buf;
+	if (files.size() >= MAX_FILES)
+		files.clear();  // Working set is expected to fit, so simplest eviction is enough
+	files[path] = Entry{file, now};
+	return file;
+}
+
+inline const std::string *find_header(const http::RequestHeader &request, const char *name) {
+	for (const auto &h : request.headers)
+		if (h.name == name)
+			return &h.value;
+	return nullptr;
+}
+
+CRAB_INLINE bool etag_list_contains(const std::string &list, const std::string &etag) {
+	// Weak comparison, as required for If-None-Match, our etags are strong
+	size_t pos = 0;
+	while (pos < list.size()) {
+		size_t end = list.find(',', pos);
+		if (end == std::string::npos)
+			end = list.size();
+		while (pos < end && http::is_sp(list[pos]))
+			pos += 1;
+		size_t last = end;
+		while (last > pos && http::is_sp(list[last - 1]))
+			last -= 1;
+		if (last - pos == 1 && list[pos] == '*')
+			return true;
+		if (list.compare(pos, 2, "W/") == 0)
+			pos += 2;
+		if (list.compare(pos, last - pos, etag) == 0)
+			return true;
+		pos = end + 1;
+	}
+	return false;
+}
+
+CRAB_INLINE bool parse_range_number(const std::string &value, size_t &pos, uint64_t &result) {
+	const size_t start = pos;
+	result             = 0;
+	for (; pos < value.size() && value[pos] >= '0' && value[pos] <= '9'; ++pos)  // Saturates, large values are unsatisfiable
+		result = result < 100000000000000000ULL ? result * 10 + (value[pos] - '0') : std::numeric_limits<uint64_t>::max();
+	return pos != start;
+}
+
+CRAB_INLINE int static_file_status(const http::RequestHeader &request, const StaticFile &file, uint64_t &begin, uint64_t &end) {
+	begin = 0;
+	end   = file.size;
+	if (request.method != "GET" && request.method != "HEAD")
+		return 200;
+	if (auto if_none_match = find_header(request, "if-none-match")) {
+		if (etag_list_contains(*if_none_match, file.etag))
+			return 304;
+	} else if (auto if_modified_since = find_header(request, "if-modified-since")) {
+		if (*if_modified_since == file.last_modified)
+			return 304;
+	}
+	auto range = find_header(request, "range");
+	if (!range || request.method != "GET" || range->compare(0, 6, "bytes=") != 0)
+		return 200;
+	auto if_range = find_header(request, "if-range");
+	if (if_range && *if_range != file.etag && *if_range != file.last_modified)
+		return 200;  // Changed, so whole file
+	size_t pos = 6;
+	uint64_t first = 0, last = 0;
+	const bool has_first = parse_range_number(*range, pos, first);
+	if (pos == range->size() || (*range)[pos] != '-')
+		return 200;
+	pos += 1;
+	const bool has_last = parse_range_number(*range, pos, last);
+	if (pos != range->size() || (!has_first && !has_last) || (has_first && has_last && last < first))
+		return 200;
+	if (!has_first) {  // Suffix
+		if (last == 0 || file.size == 0)
+			return 416;
+		begin = file.size - std::min(last, file.size);
+		return 206;
+	}
+	if (first >= file.size)
+		return 416;
+	begin = first;
+	if (has_last)
+		end = std::min(last, file.size - 1) + 1;
+	return 206;
+}
+
+CRAB_INLINE const char *static_file_content_type(const std::string &path) {
+	struct Mapping {
+		const char *extension;
+		const char *content_type;
+	};
+	static const Mapping mappings[] = {{".html", "text/html; charset=utf-8"}, {".htm", "text/html; charset=utf-8"},
+	    {".css", "text/css; charset=utf-8"}, {".js", "text/javascript; charset=utf-8"}, {".json", "application/json"},
+	    {".txt", "text/plain; charset=utf-8"}, {".xml", "application/xml"}, {".svg", "image/svg+xml"}, {".png", "image/png"},
+	    {".jpg", "image/jpeg"}, {".jpeg", "image/jpeg"}, {".gif", "image/gif"}, {".webp", "image/webp"},
+	    {".ico", "image/x-icon"}, {".wasm", "application/wasm"}, {".woff2", "font/woff2"}, {".pdf", "application/pdf"}};
+	for (const auto &m : mappings) {
+		const size_t len = std::strlen(m.extension);
+		if (path.size() >= len && path.compare(path.size() - len, len, m.extension) == 0)
+			return m.content_type;
+	}
+	return "application/octet-stream";
+}
+
+}  // namespace details
+#endif
+
+namespace http {
 
 CRAB_INLINE void Client::write(Response &&response) {
 	// HTTP message length design is utter crap, we should conform better...
@@ -31,6 +196,47 @@ CRAB_INLINE void Client::write(Response &&response) {
 	d_handler = nullptr;
 }
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+CRAB_INLINE bool Client::write_file(const RequestHeader &request, const std::string &path, const std::string &content_type) {
+	auto file = details::StaticHolderTL<details::StaticFileCache>::instance.open(path);
+	if (!file)
+		return false;
+	uint64_t begin = 0;
+	uint64_t end   = 0;
+	ResponseHeader response;
+	response.status = details::static_file_status(request, *file, begin, end);
+	response.date   = Server::get_date();
+	response.server = "crab";
+	response.set_content_type(content_type.empty() ? details::static_file_content_type(path) : content_type);
+	response.headers.push_back(Header{"accept-ranges", "bytes"});
+	response.headers.push_back(Header{"etag", file->etag});
+	response.headers.push_back(Header{"last-modified", file->last_modified});
+	d_handler = nullptr;
+	if (response.status == 304) {
+		response.content_length = file->size;  // Allowed, as it is the same as for 200
+		ServerConnection::write_head(response);
+		return true;
+	}
+	if (response.status == 416) {
+		response.headers.push_back(Header{"content-range", "bytes */" + std::to_string(file->size)});
+		response.content_length = 0;
+		ServerConnection::write_head(response);
+		return true;
+	}
+	if (response.status == 206)
+		response.headers.push_back(Header{"content-range",
+		    "bytes " + std::to_string(begin) + "-" + std::to_string(end - 1) + "/" + std::to_string(file->size)});
+	response.content_length = end - begin;
+	if (request.method == "HEAD") {
+		ServerConnection::write_head(response);
+		return true;
+	}
+	ServerConnection::write(response, BUFFER_ONLY);
+	ServerConnection::write_file(std::shared_ptr<const details::FileDescriptor>(file, &file->fd), begin, end - begin);
+	return true;
+}
+#endif
+
 CRAB_INLINE void Client::write(WebMessage &&wm) {
 	if (wm.is_close())
 		web_message_close_sent = true;
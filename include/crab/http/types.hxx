@@ -67,8 +67,8 @@ CRAB_INLINE const std::string &status_to_string(int status) {
 		int code;
 		std::string text;
 	};
-	static const smapping smappings[]       = {{101, "Switching Protocols"}, {200, "OK"}, {400, "Bad request"}, {401, "Unauthorized"},
-        {403, "Forbidden"}, {404, "Not found"}, {422, "Unprocessable Entity"}, {500, "Internal Error"}, {501, "Not implemented"},
+	static const smapping smappings[]       = {{101, "Switching Protocols"}, {200, "OK"}, {206, "Partial Content"}, {304, "Not Modified"}, {400, "Bad request"}, {401, "Unauthorized"},
+        {403, "Forbidden"}, {404, "Not found"}, {416, "Range Not Satisfiable"}, {422, "Unprocessable Entity"}, {500, "Internal Error"}, {501, "Not implemented"},
         {502, "Service temporarily overloaded"}, {503, "Gateway timeout"}};
 	static const std::string unknown_status = "Unknown";
 
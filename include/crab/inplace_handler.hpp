@@ -0,0 +1,113 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace crab {
+
+// Move-only replacement of std::function<void()>, which never allocates. Callable object is stored inside,
+// if it does not fit, compilation fails. Capture pointer to state instead of big objects, or, if allocation
+// is acceptable, wrap callable into std::function, which fits if Capacity is at least sizeof(std::function)
+// (32 bytes in libstdc++, 48 in libc++, 64 in MSVC). crab::Handler capacity is selected so that it fits.
+
+template<size_t Capacity>
+class InplaceHandler {
+public:
+	enum { CAPACITY = Capacity };
+
+	InplaceHandler() noexcept = default;
+	InplaceHandler(std::nullptr_t) noexcept {}  // NOLINT
+	template<class F, class D = typename std::decay<F>::type,
+	    class = typename std::enable_if<!std::is_same<D, InplaceHandler>::value>::type>
+	InplaceHandler(F &&f) {  // NOLINT, implicit like std::function
+		static_assert(sizeof(D) <= Capacity, "Handler captures are too large, capture pointer to state or wrap into std::function");
+		static_assert(alignof(D) <= alignof(Storage), "Handler captures are over-aligned");
+		D *target = new (&storage) D(std::forward<F>(f));
+		if (is_null(*target)) {  // Like std::function, null function pointer makes empty handler
+			target->~D();
+			return;
+		}
+		invoke = &invoke_impl<D>;
+		manage = &manage_impl<D>;
+	}
+	InplaceHandler(InplaceHandler &&other) noexcept { take(other); }
+	InplaceHandler &operator=(InplaceHandler &&other) noexcept {
+		if (this != &other) {
+			reset();
+			take(other);
+		}
+		return *this;
+	}
+	InplaceHandler &operator=(std::nullptr_t) noexcept {
+		reset();
+		return *this;
+	}
+	template<class F, class D = typename std::decay<F>::type,
+	    class = typename std::enable_if<!std::is_same<D, InplaceHandler>::value>::type>
+	InplaceHandler &operator=(F &&f) {
+		return *this = InplaceHandler(std::forward<F>(f));
+	}
+	InplaceHandler(const InplaceHandler &) = delete;
+	InplaceHandler &operator=(const InplaceHandler &) = delete;
+	~InplaceHandler() { reset(); }
+
+	explicit operator bool() const noexcept { return invoke != nullptr; }
+	void operator()() const {
+		if (!invoke)
+			throw std::bad_function_call();
+		invoke(&storage);
+	}
+	void reset() noexcept {
+		if (manage)
+			manage(&storage, nullptr);
+		invoke = nullptr;
+		manage = nullptr;
+	}
+
+private:
+	using Storage = typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type;
+
+	mutable Storage storage;
+	void (*invoke)(void *)              = nullptr;  // Direct pointer, so call is single indirection like virtual call
+	void (*manage)(void *dst, void *src) = nullptr;  // src != nullptr - move src into dst, then destroy src, else destroy dst
+
+	template<class D>
+	static void invoke_impl(void *self) {
+		(*static_cast<D *>(self))();
+	}
+	template<class D>
+	static void manage_impl(void *dst, void *src) {
+		if (src) {
+			new (dst) D(std::move(*static_cast<D *>(src)));
+			static_cast<D *>(src)->~D();
+		} else {
+			static_cast<D *>(dst)->~D();
+		}
+	}
+	void take(InplaceHandler &other) noexcept {
+		if (!other.manage)
+			return;
+		other.manage(&storage, &other.storage);  // Lambdas and std::function do not throw on move
+		invoke       = other.invoke;
+		manage       = other.manage;
+		other.invoke = nullptr;
+		other.manage = nullptr;
+	}
+	template<class T>
+	static bool is_null(const T &) {
+		return false;
+	}
+	template<class R>
+	static bool is_null(R (*const &f)()) {
+		return f == nullptr;
+	}
+	static bool is_null(const std::function<void()> &f) { return !f; }
+};
+
+}  // namespace crab
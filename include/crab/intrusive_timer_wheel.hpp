@@ -0,0 +1,152 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+// Hierarchical timing wheel, approach by George Varghese and Tony Lauck
+// http://www.cs.columbia.edu/~nahum/w6998/papers/sosp87-timing-wheels.pdf
+
+#pragma once
+
+#include <cstdint>
+#include "intrusive_list.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace crab {
+
+// Intrusive timer wheel has O(1) complexity of insert and erase, and amortized O(1) expiration
+// (each element is cascaded at most LEVELS times during its life). Unlike intrusive heap,
+// it does not allocate at all and erase is just unlinking of the node.
+
+// Time is measured in integer ticks, caller selects tick duration and converts, element
+// stores its expiration tick in a field pointed by Tick, which must not change while element is in a wheel.
+// Elements with tick <= current tick are moved into expired list by advance(), in unspecified order.
+// Elements further than 2^(SLOT_BITS * LEVELS) ticks into the future are parked in the top level
+// and cascaded again, when time comes.
+
+template<typename T, IntrusiveNode<T> T::*Link, uint64_t T::*Tick>
+class IntrusiveTimerWheel : private Nocopy {
+public:
+	enum { SLOT_BITS = 6, SLOTS = 1 << SLOT_BITS, LEVELS = 6 };
+
+	explicit IntrusiveTimerWheel(uint64_t current_tick = 0) : current(current_tick) {}
+
+	bool empty() const { return count == 0; }
+	size_t size() const { return count; }
+	uint64_t current_tick() const { return current; }
+
+	bool insert(T &node) {  // node.*Tick must be set by caller
+		if ((node.*Link).in_list())
+			return false;
+		place(node);
+		count += 1;
+		return true;
+	}
+	size_t erase(T &node) {  // Works for both waiting and expired elements
+		if (!(node.*Link).in_list())
+			return 0;
+		(node.*Link).unlink();  // If slot becomes empty, bit in occupied is cleared lazily in next_tick()
+		count -= 1;
+		return 1;
+	}
+
+	// Expired elements stay in a wheel (is in_list()) until erased
+	bool has_expired() const { return !expired.empty(); }
+	T &front_expired() { return expired.front(); }
+
+	// Moves all elements with tick <= new_tick into expired list. Time never goes back.
+	// Jumps over empty slots, so large advances are cheap.
+	void advance(uint64_t new_tick) {
+		while (current < new_tick) {
+			uint64_t next = new_tick;
+			next_tick(next);
+			current = next;
+			cascade();
+		}
+	}
+
+	// Returns lower bound of the tick, when next waiting element expires (before cascading,
+	// we do not know exact tick, so it is the tick when its slot will be cascaded).
+	// Does not change tick if there are no waiting elements. Expired elements are not considered.
+	void next_tick(uint64_t &tick) {
+		for (size_t level = 0; level != LEVELS; ++level) {
+			const uint64_t unit = current >> (level * SLOT_BITS);
+			while (occupied[level] != 0) {
+				const size_t first  = size_t(unit + 1) % SLOTS;
+				const uint64_t mask = first == 0 ? occupied[level] : (occupied[level] >> first) | (occupied[level] << (SLOTS - first));
+				const uint64_t next_unit = unit + 1 + count_trailing_zeroes(mask);
+				const size_t slot        = size_t(next_unit) % SLOTS;
+				if (slots[level][slot].empty()) {
+					occupied[level] &= ~(uint64_t(1) << slot);
+					continue;
+				}
+				const uint64_t next = next_unit << (level * SLOT_BITS);
+				if (next < tick)
+					tick = next;
+				break;
+			}
+		}
+	}
+
+private:
+	using List = IntrusiveList<T, Link>;
+
+	List slots[LEVELS][SLOTS];
+	uint64_t occupied[LEVELS]{};
+	List expired;
+	uint64_t current = 0;
+	size_t count     = 0;
+
+	void place(T &node) {
+		const uint64_t tick = node.*Tick;
+		if (tick <= current) {
+			expired.push_back(node);
+			return;
+		}
+		size_t level = 0;
+		for (; level != LEVELS; ++level)
+			if ((tick >> (level * SLOT_BITS)) - (current >> (level * SLOT_BITS)) < SLOTS)
+				break;
+		uint64_t unit = 0;
+		if (level == LEVELS) {  // Too far in the future, park in the last slot of top level
+			level = LEVELS - 1;
+			unit  = (current >> (level * SLOT_BITS)) + SLOTS - 1;
+		} else {
+			unit = tick >> (level * SLOT_BITS);
+		}
+		const size_t slot = size_t(unit) % SLOTS;
+		slots[level][slot].push_back(node);
+		occupied[level] |= uint64_t(1) << slot;
+	}
+	void cascade() {
+		// Top-down, so elements from higher level can land in lower level slot, which is cascaded next
+		for (size_t level = LEVELS; level-- > 1;) {
+			if ((current & ((uint64_t(1) << (level * SLOT_BITS)) - 1)) != 0)
+				continue;
+			List &list = slots[level][size_t(current >> (level * SLOT_BITS)) % SLOTS];
+			while (!list.empty()) {
+				T &node = list.front();
+				(node.*Link).unlink();
+				place(node);
+			}
+		}
+		List &list = slots[0][size_t(current) % SLOTS];
+		while (!list.empty()) {
+			T &node = list.front();
+			(node.*Link).unlink();
+			expired.push_back(node);
+		}
+	}
+	static size_t count_trailing_zeroes(uint64_t mask) {  // mask != 0
+#if defined(_MSC_VER)
+		unsigned long index = 0;
+		_BitScanForward64(&index, mask);
+		return index;
+#else
+		return __builtin_ctzll(mask);
+#endif
+	}
+};
+
+}  // namespace crab
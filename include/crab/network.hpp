@@ -3,8 +3,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <condition_variable>
+#include <deque>
 #include <iosfwd>
+#include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -30,17 +34,32 @@ public:
 	void once(steady_clock::duration delay);
 	void once_at(steady_clock::time_point time_point);
 
+	// Timer with slack can fire up to slack later. Fire time is rounded up to the boundary of the largest
+	// power of 2 interval not exceeding slack, so timers set around the same time get the same fire time,
+	// and fire one after another in single loop wakeup. Use for pings and idle timeouts of many connections.
+	void once(double delay_seconds, double slack_seconds);
+	void once(steady_clock::duration delay, steady_clock::duration slack);
+	void once_at(steady_clock::time_point time_point, steady_clock::duration slack);
+
 	bool is_set() const;
 	void cancel();
 
 private:
 	Handler a_handler;
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_WINDOWS
+	static steady_clock::duration to_duration(double seconds);  // clamps instead of overflow
+	static steady_clock::time_point coalesce(steady_clock::time_point time_point, steady_clock::duration slack);
+
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_WINDOWS
+#if CRAB_TIMER_WHEEL
+	IntrusiveNode<Timer> wheel_node;
+	uint64_t wheel_tick = 0;  // Part of wheel invariant, must not change, while timer is set
+#else
 	struct HeapPred {
 		bool operator()(const Timer &a, const Timer &b) { return a.fire_time > b.fire_time; }
 	};
 	IntrusiveHeapIndex heap_index;
+#endif
 	steady_clock::time_point fire_time;  // Part of heap invariant, must not change, while timer is set
 	steady_clock::time_point moved_fire_time;
 	friend struct details::RunLoopLinks;
@@ -56,6 +75,46 @@ private:
 #endif
 };
 
+class DeadlineQueue;
+
+// Timeout with duration fixed at construction, like ping or idle timeout of connection. Deadlines with the same
+// duration share DeadlineQueue owned by RunLoop. As they are armed in order of time, queue is FIFO list, so arm,
+// re-arm and cancel are O(1) without heap, and only queue head is a real Timer.
+class Deadline {
+public:
+	Deadline(steady_clock::duration duration, Handler &&cb);
+	void set_handler(Handler &&cb) { a_handler = std::move(cb); }
+	~Deadline() { cancel(); }
+
+	void arm();  // fire after duration from now, calling arm() on armed deadline moves it
+	bool is_set() const { return queue_node.in_list(); }
+	void cancel() { queue_node.unlink(); }  // Queue timer will notice on its next run
+
+private:
+	DeadlineQueue &queue;
+	Handler a_handler;
+	steady_clock::time_point fire_time;
+	IntrusiveNode<Deadline> queue_node;
+	friend class DeadlineQueue;
+};
+
+class DeadlineQueue : private Nocopy {
+public:
+	explicit DeadlineQueue(steady_clock::duration duration);
+	steady_clock::duration get_duration() const { return duration; }
+	// Head timer is set with slack of duration / SLACK_FRACTION, so deadlines armed close to each other fire in single wakeup
+	enum { SLACK_FRACTION = 32 };
+
+private:
+	friend class Deadline;
+	void arm(Deadline &deadline);
+	void on_timer();
+
+	const steady_clock::duration duration;
+	IntrusiveList<Deadline, &Deadline::queue_node> deadlines;  // ordered by fire_time
+	Timer timer;
+};
+
 class Watcher {
 public:
 	explicit Watcher(Handler &&cb);
@@ -70,8 +129,11 @@ private:
 	RunLoop *loop = nullptr;  // Will need when calling from the other threads
 	Callable a_handler;
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_WINDOWS
-	IntrusiveNode<Watcher> fired_objects_node;  // protected by RunLoop mutex
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_WINDOWS
+	// Lock-free stack of called watchers, see RunLoopLinks::call_watcher
+	Watcher *called_next = nullptr;          // owned by whoever has set in_called_list
+	std::atomic<bool> in_called_list{false};  // true from push till loop takes watcher from the stack
+	std::atomic<bool> called{false};          // reset by cancel(), so watcher in the stack is skipped
 	friend struct details::RunLoopLinks;
 #elif CRAB_IMPL_LIBEV
 	ev::async impl;
@@ -123,14 +185,21 @@ private:
 class Signal {
 public:
 	explicit Signal(Handler &&cb, std::vector<int> signals = std::vector<int>{});
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	void set_handler(Handler &&cb) { s_handler = std::move(cb); }
+#else
 	void set_handler(Handler &&cb) { a_handler.handler = std::move(cb); }
+#endif
 	~Signal();
 
 	static bool running_under_debugger();
 	// Sometimes signals interfere with debugger. Use this fun to conditionally create Signal
 private:
 	Callable a_handler;
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	Handler s_handler;  // a_handler reads signalfd, then calls s_handler
+#endif
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING
 	std::vector<int> signals;
 	details::FileDescriptor fd;
 #elif CRAB_IMPL_LIBEV
@@ -160,7 +229,7 @@ public:
 	bool is_local() const;
 	uint32_t get_ip4() const;
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_LIBEV || CRAB_IMPL_WINDOWS || CRAB_IMPL_CF
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV || CRAB_IMPL_WINDOWS || CRAB_IMPL_CF
 	const sockaddr *impl_get_sockaddr() const { return reinterpret_cast<const sockaddr *>(&addr); }
 	sockaddr *impl_get_sockaddr() { return reinterpret_cast<sockaddr *>(&addr); }
 	int impl_get_sockaddr_length() const;
@@ -186,24 +255,80 @@ namespace details {
 // https://stackoverflow.com/questions/17430377/error-when-using-in-class-initialization-of-non-static-data-member-and-nested-cl
 struct UDPSocketSettings {
 	std::string adapter;
-	size_t sndbuf_size = 0;  // 0 is do not set
-	size_t rcvbuf_size = 0;  // 0 is do not set
+	size_t sndbuf_size = 0;      // 0 is do not set
+	size_t rcvbuf_size = 0;      // 0 is do not set
+	bool udp_gso       = false;  // Linux 4.18+, UDPTransmitter::write_segmented sends up to 64 datagrams with single sendmsg
+	bool udp_gro       = false;  // Linux 5.0+, kernel coalesces datagrams of the same flow, see UDPReceiver::DatagramBuffer
+	bool rx_timestamps = false;  // kernel receive time of datagrams, see read_datagram and DatagramBuffer::timestamp
+	bool tx_timestamps = false;  // Linux only, kernel send time of datagrams, see read_tx_timestamp
 };
 
 struct TCPSocketSettings {
 	bool tcp_delay     = false;
-	size_t sndbuf_size = 0;  // 0 is do not set
-	size_t rcvbuf_size = 0;  // 0 is do not set
+	size_t sndbuf_size = 0;      // 0 is do not set
+	size_t rcvbuf_size = 0;      // 0 is do not set
+	bool rx_timestamps = false;  // kernel receive time of data, see TCPSocket::read_some with timestamp
 };
 
 struct TCPAcceptorSettings : public TCPSocketSettings {
 	// TCPAcceptor will set TCPSocketSettings for all accepted sockets (through listen socket or manualy)
 	bool reuse_addr = false;
 	bool reuse_port = false;
+	std::vector<int> reuse_port_cpus;
+	// Linux only, with reuse_port set. Attaches CBPF program to reuse port group, so that connection received
+	// by CPU equal to reuse_port_cpus[i] goes to i-th socket of the group (sockets are numbered in the order
+	// of listen()), other connections are distributed by CPU modulo group size. RunLoopGroup sets it for you.
+};
+
+struct RunLoopGroupSettings {
+	size_t threads = 0;  // 0 means std::thread::hardware_concurrency()
+	std::vector<int> cpus;
+	// thread with index i is pinned to cpus[i % cpus.size()], empty means no pinning
+	bool steer_by_incoming_cpu = false;
+	// Linux only, connection goes to the loop pinned to CPU, which received it, so processing
+	// stays cache-local. If cpus are empty, they are set to 0..threads-1
+};
+
+struct DNSResolverSettings {
+	size_t threads           = 4;      // getaddrinfo blocks, so slow lookup occupies thread
+	double positive_ttl_sec  = 60;     // getaddrinfo does not report TTL, so we use fixed one
+	double negative_ttl_sec  = 5;      // failed lookups are also cached, 0 disables caching
+	size_t max_cache_entries = 10000;  // expired entries are purged when reached, then whole cache
+};
+
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+struct ZeroCopyState {
+	bool supported   = false;  // SO_ZEROCOPY is enabled on first write_zerocopy, old kernels do not have it
+	uint32_t next_id = 0;      // kernel numbers successful MSG_ZEROCOPY sends of socket from 0
+	std::deque<std::pair<uint32_t, std::shared_ptr<const void>>> pending;
 };
+void read_zerocopy_completions(int fd, ZeroCopyState &state);  // releases holders of completed sends
+
+// Socket closed with MSG_ZEROCOPY sends in flight is shut down, but stays open in its RunLoop, until kernel
+// reports that it is done with all pages, only then holders are released. Reports are waited for as EPOLLERR.
+class ZeroCopyLingerList : private Nocopy {
+public:
+	enum { USER_TIMEOUT_MS = 30000 };  // peer not reading cannot hold pages longer than timeout
+	ZeroCopyLingerList() = default;
+	~ZeroCopyLingerList();  // holders still pending are leaked, as kernel can still read their pages
+
+	void add(FileDescriptor &fd, std::unique_ptr<ZeroCopyState> &&state);  // takes fd if sends are in flight
+
+private:
+	struct Linger {
+		Callable handler{Handler{}};  // Destroyed after fd, see ~Callable
+		FileDescriptor fd;
+		std::unique_ptr<ZeroCopyState> state;
+	};
+	std::list<Linger> sockets;  // nodes are stable, so handlers are registered in loop
+	void on_error_queue(std::list<Linger>::iterator it);
+};
+#endif
 
 }  // namespace details
 
+class TCPHandoffReceiver;
+
 // socket is not RAII because it can go to disconnected state by external interaction
 class TCPSocket : public IStream, public OStream {
 public:
@@ -228,6 +353,10 @@ public:
 
 	void accept(TCPAcceptor &acceptor, Address *accepted_addr = nullptr);
 	// throws if acceptor.can_accept() is false, so check can_accept() before
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	void accept(TCPHandoffReceiver &receiver, Address *accepted_addr = nullptr);
+	// adopts connection accepted in other loop, throws if receiver.can_accept() is false
+#endif
 
 	size_t read_some(uint8_t *val, size_t count) override;
 	// reads 0..count-1, if returns 0 (incoming buffer empty) would
@@ -266,14 +395,45 @@ public:
 	size_t read_some(uint8_t *val, size_t count, uint8_t *val2, size_t count2);
 	size_t write_some(std::deque<Buffer> &data);
 
+	enum { MAX_SLICES = 1024 };  // IOV_MAX on Linux and BSD
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+	size_t read_some(const MutableSlice *slices, size_t count) override;
+	size_t write_some(const ConstSlice *slices, size_t count) override;
+	// single recvmsg/sendmsg with first min(count, MAX_SLICES) slices, otherwise the same as versions above
+	size_t write_file(int file_fd, uint64_t offset, size_t count);
+	// sends up to count bytes of file from offset straight from page cache (sendfile), otherwise the same as
+	// write_some. File fd is not owned, it must stay open during call only. File position is not changed.
+	// On Linux, SIGPIPE is blocked on the thread during call, unless ignored, so ignore it to save syscalls.
+	size_t read_some(uint8_t *val, size_t count, std::chrono::system_clock::time_point *timestamp);
+	// with Settings::rx_timestamps, sets timestamp to kernel receive time of the last segment read, otherwise
+	// leaves it unchanged. Kernel time is CLOCK_REALTIME, so compare with system_clock::now(), not RunLoop::now()
+#endif
+
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	// Linux only. Like write_some, but kernel pins pages of val instead of copying them, so data must not change
+	// until kernel reports (via socket error queue) that it is done with them. Socket keeps holder (usually
+	// shared_ptr to the owner of val) until then. If socket is closed before that, RunLoop keeps it open (shut down)
+	// and holders alive, until all reports arrive. Falls back to copying, if kernel does not support SO_ZEROCOPY.
+	// Pinning and notifications are not free, so use only for writes of tens of KB and more.
+	size_t write_zerocopy(const uint8_t *val, size_t count, std::shared_ptr<const void> holder);
+	void read_zerocopy_completions();
+	// releases holders of completed sends, called from read_some, call from your handler if you do not read
+	size_t get_zerocopy_pending() const { return zerocopy ? zerocopy->pending.size() : 0; }
+#endif
+
 	Address local_address() const;
 	Address remote_address() const;
 
 private:
 	Callable rwd_handler;
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_LIBEV
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
 	details::FileDescriptor fd;
+	void accept_fd(details::FileDescriptor &accepted_fd);
+	size_t read_slices(const MutableSlice *slices, size_t count, std::chrono::system_clock::time_point *timestamp);
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	std::unique_ptr<details::ZeroCopyState> zerocopy;  // Created on first write_zerocopy, given to loop on close
+#endif
 #if CRAB_IMPL_LIBEV
 	ev::io io_read;
 	ev::io io_write;
@@ -298,17 +458,22 @@ class TCPAcceptor {
 public:
 	using Settings = details::TCPAcceptorSettings;
 	explicit TCPAcceptor(const Address &address, Handler &&cb, const Settings &settings = Settings{});
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
+	explicit TCPAcceptor(int listening_fd, Handler &&cb);
+	// Takes ownership of socket already bound and listening, for example passed by parent process or systemd
+#endif
 	void set_handler(Handler &&cb) { a_handler.handler = std::move(cb); }
 	~TCPAcceptor();
 
 	bool can_accept();  // Very fast if nothing to accept
 
 private:
-	friend class TCPSocket;  // accept needs access
+	friend class TCPSocket;   // accept needs access
+	friend class TCPHandoff;  // as well as handoff
 
 	Callable a_handler;
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_LIBEV
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
 	details::FileDescriptor fd;
 
 	// We actually accept in can_accept, so that TCPSocket::accept never fails
@@ -342,28 +507,53 @@ private:
 // Also good for client, talking to single server
 class UDPTransmitter {
 public:
+	using Settings = details::UDPSocketSettings;
+
 	explicit UDPTransmitter(const Address &address, Handler &&cb, const std::string &adapter = std::string{});
+	UDPTransmitter(const Address &address, Handler &&cb, const Settings &settings);
 	// If multicast group address is used, receiver will transmit on specified or default adapter
 	void set_handler(Handler &&cb) { rw_handler.handler = std::move(cb); }
 
 	bool write_datagram(const uint8_t *data, size_t count);
 	// returns false if buffer is full or a error occurs
 	// cannot return size_t, because datagrams of zero size are valid
+	size_t write_datagrams(const ConstSlice *datagrams, size_t count);
+	// each slice is a datagram, sent with sendmmsg on Linux in batches of MAX_DATAGRAMS_BATCH
+	// returns number of datagrams sent, if less than count, buffer is full and handler will be called
+	size_t write_segmented(const uint8_t *data, size_t count, size_t segment_size);
+	// sends data as run of datagrams of segment_size (the last one can be shorter), returns number of datagrams sent.
+	// With Settings::udp_gso kernel splits each MAX_GSO_SEGMENTS of them from single sendmsg, if it rejects
+	// UDP_SEGMENT (old kernel, segment_size above path MTU), socket falls back to write_datagrams
 	bool can_write() const;
 	// write_datagram will return false if cannot write, but this is too late for clients
 	// who wish to work without buffer and need to prepare data,
 
 	// read_datagram will read replies from server, if replies are sent.
 	// expect any garbage from any host, as usual with UDP
-	optional<size_t> read_datagram(uint8_t *data, size_t count, Address *peer_addr = nullptr);
+	optional<size_t> read_datagram(uint8_t *data, size_t count, Address *peer_addr = nullptr,
+	    std::chrono::system_clock::time_point *timestamp = nullptr);
+	// with Settings::rx_timestamps, timestamp is set to kernel receive time, otherwise to time_point{}.
+	// Kernel time is CLOCK_REALTIME, so compare with system_clock::now(), not RunLoop::now()
+
+	struct TxTimestamp {
+		uint32_t id = 0;  // socket numbers sends from 0, each datagram of write_datagrams counts, GSO sendmsg counts once
+		std::chrono::system_clock::time_point timestamp;
+	};
+	bool read_tx_timestamp(TxTimestamp &ts);
+	// with Settings::tx_timestamps (Linux only), kernel reports when each send left the stack via socket error
+	// queue, which also triggers handler. Returns false if there are no more reports. Queue must be drained,
+	// otherwise kernel stops reporting when it reaches rcvbuf_size.
+
+	enum { MAX_DATAGRAMS_BATCH = 64, MAX_GSO_SEGMENTS = 64 };
 
 	void set_multicast_ttl(int ttl);
 
 private:
 	Callable rw_handler;
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_LIBEV
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
 	details::FileDescriptor fd;
+	bool udp_gso = false;  // cleared if kernel rejects UDP_SEGMENT
 #if CRAB_IMPL_LIBEV
 	ev::io io_read;
 	void io_cb_read(ev::io &, int);
@@ -388,34 +578,62 @@ public:
 	void set_handler(Handler &&cb) { rw_handler.handler = std::move(cb); }
 
 	static constexpr size_t MAX_DATAGRAM_SIZE = 65507;  // https://stackoverflow.com/questions/42609561/udp-maximum-packet-size/42610200
-	optional<size_t> read_datagram(uint8_t *data, size_t count, Address *peer_addr = nullptr);
+	optional<size_t> read_datagram(uint8_t *data, size_t count, Address *peer_addr = nullptr,
+	    std::chrono::system_clock::time_point *timestamp = nullptr);
 	// returns () if buffer is empty
 	// returns (datagram_size) if datagram was read, even if it was truncated
+	// timestamp is set like in UDPTransmitter::read_datagram
 	// We do not consider truncation as an error here. Any sane protocol will detect truncated
 	// message in its own higher-level logic. We return true so clients state machine will be simpler
+	// with Settings::udp_gro, coalesced datagrams are returned one by one, rest are kept until next call
 
 	bool write_datagram(const uint8_t *data, size_t count, const Address &peer_addr);
 	// for sending replies
 	// returns false if buffer is full or a error occurs
 	// cannot return size_t, because datagrams of zero size are valid
+	size_t write_datagrams(const ConstSlice *datagrams, const Address *peer_addrs, size_t count);
+	// datagrams[i] is sent to peer_addrs[i], returns number of datagrams sent, like UDPTransmitter::write_datagrams
 	bool can_write() const;
 	// write_datagram will return false if cannot write, but this is too late for clients
 	// who wish to work without buffer and need to prepare data,
 
+	using TxTimestamp = UDPTransmitter::TxTimestamp;
+	bool read_tx_timestamp(TxTimestamp &ts);  // Like UDPTransmitter::read_tx_timestamp
+
 	// Experimental API
 	struct DatagramBuffer {
 		uint8_t data[MAX_DATAGRAM_SIZE];  // Uninitialized, be careful
-		size_t count = 0;
+		size_t count        = 0;
+		size_t segment_size = 0;  // With Settings::udp_gro, data can contain several datagrams coalesced by kernel
 		Address peer_addr;
+		std::chrono::system_clock::time_point timestamp;  // With Settings::rx_timestamps, kernel receive time
 		// TODO - add per datagram adapter information so replies can be sent via correct interfaces
+
+		// Each datagram is segment_size, except the last one, which can be shorter
+		size_t datagram_count() const { return segment_size == 0 ? 1 : (count + segment_size - 1) / segment_size; }
+		ConstSlice datagram(size_t i) const {
+			if (segment_size == 0)
+				return ConstSlice{data, count};
+			return ConstSlice{data + i * segment_size, std::min(segment_size, count - i * segment_size)};
+		}
 	};
 	size_t read_datagrams(DatagramBuffer *buffer, size_t buffer_len);
+	// reads up to min(buffer_len, MAX_DATAGRAMS_BATCH) datagrams with single recvmmsg on Linux,
+	// returns number of buffers filled, 0 if buffer is empty (handler will be called)
+	// with Settings::udp_gro, use DatagramBuffer::datagram() to split buffers. If read_datagram() kept rest of
+	// coalesced datagrams, they are returned first, in single buffer
+
+	enum { MAX_DATAGRAMS_BATCH = UDPTransmitter::MAX_DATAGRAMS_BATCH };
 
 private:
 	Callable rw_handler;
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_LIBEV
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
 	details::FileDescriptor fd;
+	bool udp_gro       = false;
+	bool rx_timestamps = false;
+	std::unique_ptr<DatagramBuffer> gro_buffer;  // Created on first read_datagram with udp_gro
+	size_t gro_next = 0;                         // first datagram in gro_buffer not yet returned by read_datagram
 #if CRAB_IMPL_LIBEV
 	ev::io io_read;
 	void io_cb_read(ev::io &, int);
@@ -430,25 +648,114 @@ private:
 #endif
 };
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_WINDOWS
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_WINDOWS
 
 namespace details {
+// Bounded lock-free MPSC ring, approach by Dmitry Vyukov
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+template<class T>
+class MPSCRing : private Nocopy {
+public:
+	explicit MPSCRing(size_t capacity) : cells(new Cell[capacity]), mask(capacity - 1) {  // capacity must be power of 2
+		for (size_t i = 0; i != capacity; ++i)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	bool push(T &value) {  // from any thread, value is moved only if returns true (ring is not full)
+		size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		while (true) {
+			Cell &cell     = cells[pos & mask];
+			const auto dif = static_cast<std::ptrdiff_t>(cell.sequence.load(std::memory_order_acquire) - pos);
+			if (dif == 0) {
+				if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					cell.value = std::move(value);
+					cell.sequence.store(pos + 1);  // seq_cst, pairs with RunLoopLinks::prepare_to_sleep()
+					return true;
+				}
+			} else if (dif < 0) {
+				return false;
+			} else {
+				pos = enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+	bool empty() const {  // from consumer thread
+		return cells[dequeue_pos & mask].sequence.load() != dequeue_pos + 1;
+	}
+	bool pop(T &value) {  // from consumer thread
+		Cell &cell = cells[dequeue_pos & mask];
+		if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos + 1)
+			return false;  // Empty, or producer is between claiming and publishing
+		value      = std::move(cell.value);
+		cell.value = T{};  // Release resources held by moved-from value
+		cell.sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+		dequeue_pos += 1;
+		return true;
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence{0};
+		T value{};
+	};
+	std::unique_ptr<Cell[]> cells;
+	size_t mask;
+	std::atomic<size_t> enqueue_pos{0};
+	size_t dequeue_pos = 0;  // only consumer thread
+};
+
+// When ring is full, handlers go to mutex-protected overflow queue, so push() never fails or blocks.
+// Handlers pushed from the same thread are run in order.
+class PostQueue : private Nocopy {
+public:
+	enum { CAPACITY = 1024 };  // Must be power of 2, arbitrary constant
+	PostQueue() : ring(CAPACITY) {}
+
+	void push(Handler &&handler);  // from any thread
+	bool empty() const;            // from loop thread
+	void run_all();                // from loop thread
+
+private:
+	MPSCRing<Handler> ring;
+	// Once overflow is not empty, all pushes go there, until loop takes it, so order is preserved
+	std::atomic<bool> has_overflow{false};
+	std::mutex overflow_mutex;
+	std::deque<Handler> overflow;
+};
+
 struct RunLoopLinks : private Nocopy {  // Common structure when implementing over low-level interface
+#if CRAB_TIMER_WHEEL
+	// Wheel tick is 1 ms, like poll timeout. Timers never fire early, but can fire up to 1 tick late
+	static uint64_t wheel_tick_floor(steady_clock::time_point tp);
+	static uint64_t wheel_tick_ceil(steady_clock::time_point tp);
+	IntrusiveTimerWheel<Timer, &Timer::wheel_node, &Timer::wheel_tick> active_timers{wheel_tick_floor(steady_clock::now())};
+#else
 	IntrusiveHeap<Timer, &Timer::heap_index, Timer::HeapPred> active_timers;
+#endif
 
 	IntrusiveList<Callable, &Callable::triggered_callables_node> triggered_callables;
 	steady_clock::time_point now = steady_clock::now();
 	std::atomic<bool> quit{false};
 
-	bool process_timer(int &timeout_ms);
+	bool process_timer(steady_clock::duration &timeout, PerformanceStats &stats);
+	// Either runs single expired timer and returns true, or reduces timeout to exact time until the nearest one
 
-	// protected queue below can be accessed in call_watcher from other threads
-	std::mutex mutex;
-	IntrusiveList<Watcher, &Watcher::fired_objects_node> fired_objects;
+	// Lock-free MPSC stack, watchers are pushed from any thread, loop takes all of them at once.
+	// Loop sets sleeping before blocking in step(), only the first call_watcher() after that
+	// returns true and wakes loop up, so calling watchers of busy loop costs no syscalls.
+	std::atomic<Watcher *> called_watchers{nullptr};
+	std::atomic<bool> sleeping{false};
 
-	void call_watcher(Watcher *watcher);  // from other threads
+	bool call_watcher(Watcher *watcher);  // from other threads, returns true if loop must be woken up
 	void cancel_called_watcher(Watcher *watcher);
-	void trigger_called_watchers();
+
+	// Handlers from RunLoop::post() are run by posted_callable, so they are ordered with other callables
+	PostQueue posted;
+	Callable posted_callable{[this]() { posted.run_all(); }};
+
+	bool has_cross_thread_calls() const { return called_watchers.load(std::memory_order_relaxed) != nullptr || !posted.empty(); }
+	void trigger_cross_thread_calls();
+	bool prepare_to_sleep();  // returns false if there are cross-thread calls, so we should not block
+	void finish_sleep() { sleeping.store(false); }
 };
 }  // namespace details
 #endif
@@ -469,9 +776,17 @@ public:
 	// run until cancel. quit flag is not reset, so subsequent runs will quit immediately. This is to avoid race with cancel.
 
 	void cancel();
-	// The only fun allowed to be called from different threads (except Watcher::call)
+	// The only fun allowed to be called from different threads (except Watcher::call and post)
 	// to call it the other thread will need RunLoop pointer, you can use crab::Thread for that
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_WINDOWS
+	void post(Handler &&handler);
+	void post(std::vector<Handler> &&handlers);
+	// Can be called from any thread, handler will run on this loop thread. All handlers posted before
+	// loop iteration are run in one pass. Posting does not allocate, unless preallocated ring overflows.
+	// Batch version wakes loop up at most once. Handlers not run before ~RunLoop() are destroyed.
+#endif
+
 	steady_clock::time_point now() const;
 	// will update max 1 per loop iteration. This saves a lot on syscalls, when moving 500
 	// timers of tcp socket per iteration under heavy load
@@ -480,13 +795,34 @@ public:
 
 	PerformanceStats stats;  // User stats can also be recorded here
 
+	void set_busy_poll(steady_clock::duration spin) { busy_poll_duration = spin; }
+	// Before blocking wait, loop polls without blocking for up to spin duration, checking called
+	// watchers without syscalls. Trades CPU for wakeup latency, 0 (default) disables spinning.
+	// Ignored by libev, boost::asio and Core Foundation impls
+
+	void set_precise_timers(bool precise) { precise_timers = precise; }
+	// By default loop sleeps until the nearest timer rounded up to whole milliseconds, so timers fire 0-2 ms late.
+	// Precise timers use nanosecond timeouts (epoll_pwait2 on Linux 5.11+, otherwise timerfd, io_uring and kqueue
+	// timeouts natively), so lateness is wakeup latency plus thread timer slack (50 mksec by default on Linux,
+	// see prctl(PR_SET_TIMERSLACK)). With CRAB_TIMER_WHEEL, precision is still limited by 1 ms tick.
+	// Ignored on Windows, by libev, boost::asio and Core Foundation impls
+
 	enum { MAX_SLEEP_MS = 30 * 60 * 1000 };
 	// 30 minutes
 	// On some systems, epoll_wait() timeouts greater than 35.79 minutes are treated as infinity.
 	// Spurious wakeup once every 30 minutes is harmless, timeout can be reduced further if needed.
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING
 	void impl_add_callable_fd(int fd, Callable *callable, bool read, bool write);
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	void impl_linger_zerocopy(details::FileDescriptor &fd, std::unique_ptr<details::ZeroCopyState> &&state);
+	// takes fd of closed socket, if MSG_ZEROCOPY sends are in flight, see TCPSocket::write_zerocopy
+#endif
+#if CRAB_IMPL_URING
+	void impl_remove_callable_fd(Callable *callable, bool submit_now = false);
+	// Unlike epoll, io_uring poll keeps file open, so registration must be removed before or after close()
+	// Removal is batched into the next io_uring_enter, unless submit_now is set (needed if fd is already closed)
+#endif
 #elif CRAB_IMPL_LIBEV
 	ev::loop_ref &get_impl() { return *impl.get(); }
 #elif CRAB_IMPL_CF
@@ -495,10 +831,24 @@ public:
 #endif
 
 private:
-	void step(int timeout_ms = MAX_SLEEP_MS);
 	void wakeup();
 
+	steady_clock::duration busy_poll_duration{};
+	bool precise_timers = false;
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_WINDOWS
+	void step(steady_clock::duration timeout = std::chrono::milliseconds(MAX_SLEEP_MS));  // 0 means poll
+
+	static int timeout_ms(steady_clock::duration timeout);  // rounded up, so we never wake up before timer
+	bool busy_poll(steady_clock::duration timeout);         // false if spin budget is exhausted
+	steady_clock::time_point fast_now();                    // FastClock with CRAB_TSC_CLOCK=1, otherwise steady_clock
+	steady_clock::time_point sync_now();                    // always steady_clock
+#if CRAB_TSC_CLOCK
+	FastClock fast_clock;
+#endif
+#endif
+
 	friend class Timer;
+	friend class Deadline;
 	friend class Idle;
 	friend struct Callable;
 	friend class Watcher;
@@ -510,13 +860,32 @@ private:
 	IntrusiveList<Idle, &Idle::idle_node> idle_handlers;  // None of our impls have idles
 #endif
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_WINDOWS
+	// Created on first use, destroyed first in ~RunLoop(), as their timers need current loop
+	DeadlineQueue &deadline_queue(steady_clock::duration duration);
+	std::map<steady_clock::duration::rep, std::unique_ptr<DeadlineQueue>> deadline_queues;
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	std::unique_ptr<details::ZeroCopyLingerList> zerocopy_lingers;  // Also created on first use, destroyed first
+#endif
+
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_WINDOWS
 	details::RunLoopLinks links;
 #endif
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+#if CRAB_IMPL_URING
+	std::unique_ptr<details::URing> uring;  // owns ring fd and mapped queues
+#else
 	details::FileDescriptor efd;
-#if CRAB_IMPL_EPOLL
+#endif
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
 	details::FileDescriptor wake_fd;
+#endif
+#if CRAB_IMPL_EPOLL
+	// Precise timers use epoll_pwait2, or, if kernel does not have it, timerfd armed to the nearest timer
+	bool has_epoll_pwait2 = true;
+	details::FileDescriptor timer_fd;
+	steady_clock::time_point timer_fd_deadline;  // epoch if disarmed, so we do not re-arm to the same time
+	Callable timer_callable;
+	void arm_timer_fd(steady_clock::time_point deadline);  // epoch to disarm
 #endif
 	Callable wake_callable;
 #elif CRAB_IMPL_CF
@@ -540,6 +909,10 @@ public:
 	explicit Thread(std::function<void()> &&fun);  // waits for RunLoop constructor in the started thread
 	void cancel();  // It is faster to first cancel a bunch of Threads, then join them one by one in ~Thread()
 	~Thread();      // cancels RunLoop, then joins thread
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_WINDOWS
+	bool post(Handler &&handler);  // false if RunLoop of thread is already destroyed, handler is dropped then
+	bool post(std::vector<Handler> &&handlers);
+#endif
 private:
 	RunLoop *run_loop_ptr = nullptr;
 	bool started          = false;  // We need separate condition, because we have 3 states
@@ -548,9 +921,156 @@ private:
 	std::thread th;
 };
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_WINDOWS
+// Experimental, N Threads with RunLoops, optionally pinned to CPUs. Typical use is scaling server across
+// cores, each loop creates its own server on the same port with acceptor_settings(), see http_server_multi.cpp
+class RunLoopGroup : private Nocopy {
+public:
+	using Settings = details::RunLoopGroupSettings;
+	explicit RunLoopGroup(const Settings &settings = Settings{});
+	~RunLoopGroup();  // cancels all RunLoops, then joins threads
+
+	void start(std::function<void(size_t index)> &&fun);
+	// fun is called in each thread with RunLoop already created, like in Thread, and usually creates
+	// server, then calls RunLoop::current()->run(). Next thread is started only after previous
+	// loop started running, so that listening sockets are bound in the order of thread index
+	void cancel();
+	size_t size() const { return thread_cpus.size(); }
+	bool post(size_t index, Handler &&handler) { return threads.at(index)->post(std::move(handler)); }
+
+	// Sets reuse_port and CPU steering, works with any settings derived from TCPAcceptor::Settings
+	template<class S>
+	S acceptor_settings(S acceptor_settings) const {
+		acceptor_settings.reuse_port = true;
+		if (settings.steer_by_incoming_cpu)
+			acceptor_settings.reuse_port_cpus = thread_cpus;
+		return acceptor_settings;
+	}
+
+	static bool pin_current_thread(int cpu);  // false if not supported or failed
+
+private:
+	Settings settings;
+	std::vector<int> thread_cpus;  // cpu for each thread, -1 - not pinned, size is number of threads
+	std::function<void(size_t index)> fun;
+	std::vector<std::unique_ptr<Thread>> threads;
+
+	std::mutex mu;
+	std::condition_variable cond;
+	size_t running_count = 0;
+};
+
+// Experimental, threads for CPU-bound handlers, so that network loops never block on them.
+// Each worker has its own deque, submit() distributes round-robin, idle workers steal from busy ones.
+// Completion handlers run on the RunLoop which called submit(). Worker batches completions of short tasks finished
+// within MAX_COMPLETION_DELAY_US, so that loop is woken once per batch, completions of long tasks are posted at once.
+// That loop must outlive WorkerPool.
+class WorkerPool : private Nocopy {
+public:
+	explicit WorkerPool(size_t threads = 0);  // 0 - hardware concurrency
+	~WorkerPool();
+	// Waits for running work, completions of finished work are posted. Work not yet started is dropped
+	// (destroyed on calling thread), its completions are not called.
+
+	void submit(Handler &&work, Handler &&completion);  // from RunLoop thread
+	void submit(Handler &&work);                        // from any thread, without completion
+	size_t size() const { return workers.size(); }
+	size_t get_steal_count() const { return steal_count.load(std::memory_order_relaxed); }
+
+	enum { MAX_COMPLETION_BATCH = 64, MAX_COMPLETION_DELAY_US = 50 };  // batch is usually flushed by delay
+
+private:
+	struct Task {
+		Handler work;
+		Handler completion;
+		RunLoop *loop = nullptr;
+	};
+	struct Worker {
+		std::mutex mu;
+		std::condition_variable cond;
+		std::deque<Task> tasks;  // owner pops front, thieves take from back
+		bool sleeping = false;   // protected by mu
+		std::thread th;
+	};
+	void push(Task &&task);
+	bool steal(size_t index, Task &task);
+	void worker_fun(size_t index);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<size_t> next_worker{0};
+	std::atomic<size_t> sleeping_count{0};
+	std::atomic<size_t> steal_count{0};
+	std::atomic<bool> quit{false};
+};
+#endif
+
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+namespace details {
+struct HandoffSocket {
+	int fd = -1;  // owned by whoever holds HandoffSocket
+	Address address;
+};
+}  // namespace details
+
+// Experimental, worker side of connection handoff, for hosts where each loop cannot have its own acceptor
+// (no SO_REUSEPORT, or listening socket is passed from outside). Created in worker loop, cb is called there
+// when connections arrive, then call TCPSocket::accept(receiver) while can_accept(), like with TCPAcceptor.
+class TCPHandoffReceiver : private Nocopy {
+public:
+	enum { CAPACITY = 256 };  // Must be power of 2, when full, TCPHandoff tries other receivers
+	explicit TCPHandoffReceiver(Handler &&cb);
+	~TCPHandoffReceiver();  // closes connections not yet accepted
+	void set_handler(Handler &&cb) { watcher.set_handler(std::move(cb)); }
+
+	bool can_accept();
+
+	// For LEAST_CONNECTIONS policy, call when socket accepted from this receiver is closed
+	void connection_closed() { connections.fetch_sub(1, std::memory_order_relaxed); }
+	size_t get_connections() const { return connections.load(std::memory_order_relaxed); }
+
+private:
+	friend class TCPSocket;
+	friend class TCPHandoff;
+
+	bool push(details::HandoffSocket &socket);  // from acceptor thread, false if ring is full
+
+	Watcher watcher;
+	details::MPSCRing<details::HandoffSocket> ring;
+	std::atomic<size_t> connections{0};
+
+	details::FileDescriptor accepted_fd;
+	Address accepted_addr;
+};
+
+// Experimental, accepts in the current loop and hands accepted connections to receivers in worker loops.
+// Never blocks, if all receivers are full, connections wait in listen backlog. Receivers must outlive TCPHandoff.
+class TCPHandoff : private Nocopy {
+public:
+	enum Policy { ROUND_ROBIN, LEAST_CONNECTIONS };
+	TCPHandoff(TCPAcceptor &acceptor, std::vector<TCPHandoffReceiver *> receivers, Policy policy = ROUND_ROBIN);
+	// Replaces acceptor handler
+
+	size_t get_handoff_count() const { return handoff_count; }
+
+private:
+	void on_accept();
+	TCPHandoffReceiver *select_receiver(size_t attempt);
+
+	TCPAcceptor &acceptor;
+	std::vector<TCPHandoffReceiver *> receivers;
+	Policy policy;
+	size_t next_receiver = 0;
+	size_t handoff_count = 0;
+	Timer retry_timer;  // when all receivers are full
+};
+#endif
+
+// Lookups run on pool of threads shared by all resolvers in process. Results are cached, concurrent lookups
+// of the same host are merged into one. Cache hit does not involve pool, handler is called on the next loop iteration.
 class DNSResolver {
 public:
 	typedef std::function<void(const std::vector<Address> &names)> DNS_handler;
+	using Settings = details::DNSResolverSettings;
 
 	explicit DNSResolver(DNS_handler &&handler);
 	~DNSResolver() { cancel(); }
@@ -559,6 +1079,9 @@ public:
 	bool is_open() const { return resolving; }
 	void cancel();
 
+	static void set_settings(const Settings &settings);  // pool threads are started on demand with the latest settings
+	static void clear_cache();
+
 	static std::vector<Address> sync_resolve(const std::string &host_name, uint16_t port, bool ipv4, bool ipv6);
 
 	static Address sync_resolve_single(const std::string &host_name, uint16_t port);
@@ -572,14 +1095,10 @@ private:
 	void on_handler();
 
 	bool resolving = false;
-	// vars of resolving NDSResolvers are protected by mutex in worker
-	// because worker can access them any time it takes a new job
-	std::string host_name;
-	uint16_t port = 0;
-	bool ipv4     = false;
-	bool ipv6     = false;
+	// vars of resolving DNSResolvers are protected by mutex in worker
+	// because worker can access them any time lookup completes
 	std::vector<Address> names;
-	IntrusiveNode<DNSResolver> work_queue_node;
+	IntrusiveNode<DNSResolver> work_queue_node;  // in list of resolvers waiting for the same lookup
 };
 
 }  // namespace crab
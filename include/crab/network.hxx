@@ -3,23 +3,125 @@
 
 #include <algorithm>
 #include <condition_variable>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <thread>
 #include "integer_cast.hpp"
 #include "network.hpp"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
 // TODO - play with SO_PRIORITY
 
 namespace crab {
 
-CRAB_INLINE PerformanceStats::PerformanceStats() { performance.reserve(MAX_PERFORMANCE_RECORDS); }
+CRAB_INLINE bool FastClock::tsc_is_reliable() {
+	// Invariant TSC runs at constant rate in all ACPI P-, C- and T-states, CPUID.80000007H:EDX[8]
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || (edx & (1U << 8)) == 0)
+		return false;
+#elif defined(_M_X64) || defined(_M_IX86)
+	int regs[4]{};
+	__cpuid(regs, 0x80000000);
+	if (static_cast<unsigned>(regs[0]) < 0x80000007)
+		return false;
+	__cpuid(regs, 0x80000007);
+	if ((regs[3] & (1 << 8)) == 0)
+		return false;
+#else
+	return false;
+#endif
+#if defined(__linux__)
+	// Kernel checks TSC synchronization between sockets and marks it unstable (also common in VMs)
+	std::ifstream clocksource("/sys/devices/system/clocksource/clocksource0/current_clocksource");
+	std::string name;
+	clocksource >> name;
+	if (name != "tsc")
+		return false;
+#endif
+	return true;
+}
+
+CRAB_INLINE const FastClock::Calibration &FastClock::calibration() {
+	static const Calibration cal = []() -> Calibration {
+		Calibration result;
+		if (!tsc_is_reliable())
+			return result;
+		// Precision is ~clock read jitter / calibration time, so with 10 ms and MAX_EXTRAPOLATION_MS
+		// extrapolation error is well below microsecond. Each steady_clock read is bracketed by TSC reads,
+		// and the tightest of several brackets is used, so that preemption does not spoil calibration
+		auto sample = [](steady_clock::time_point &tm, uint64_t &tsc) {
+			uint64_t best_width = std::numeric_limits<uint64_t>::max();
+			for (int i = 0; i != 16; ++i) {
+				const uint64_t before = read_ticks();
+				const auto now        = steady_clock::now();
+				const uint64_t width  = read_ticks() - before;
+				if (width < best_width) {
+					best_width = width;
+					tm         = now;
+					tsc        = before + width / 2;
+				}
+			}
+		};
+		steady_clock::time_point start_tm, tm;
+		uint64_t start_tsc = 0, tsc = 0;
+		sample(start_tm, start_tsc);
+		while (steady_clock::now() - start_tm < std::chrono::milliseconds(10)) {
+		}
+		sample(tm, tsc);
+		const uint64_t ticks = tsc - start_tsc;
+		const double nanos   = std::chrono::duration<double, std::nano>(tm - start_tm).count();
+		if (ticks == 0)
+			return result;
+		result.nanos_mult      = static_cast<uint64_t>(nanos / double(ticks) * 4294967296.0);
+		result.max_delta_ticks = static_cast<uint64_t>(double(ticks) * MAX_EXTRAPOLATION_MS * 1000000 / nanos);
+		result.use_tsc         = result.nanos_mult != 0 && result.max_delta_ticks != 0;
+		return result;
+	}();
+	return cal;
+}
 
-CRAB_INLINE void PerformanceStats::push_record(const char *event_type_literal, int fd, int count) {
-	if (performance.size() < MAX_PERFORMANCE_RECORDS)
-		performance.emplace_back(steady_clock::now(), event_type_literal, fd, count);
+CRAB_INLINE PerformanceStats::PerformanceStats() {
+#if CRAB_TRACING
+	records.reset(new TraceRecord[MAX_PERFORMANCE_RECORDS]);
+	start_ticks = trace_ticks();
+	start_tm    = steady_clock::now();
+#endif
+}
+
+CRAB_INLINE std::vector<PerformanceRecord> PerformanceStats::get_records() const {
+	std::vector<PerformanceRecord> result;
+#if CRAB_TRACING
+	const size_t end = write_pos.load(std::memory_order_acquire);
+	size_t begin     = std::max(clear_pos.load(std::memory_order_relaxed), end - std::min<size_t>(end, MAX_PERFORMANCE_RECORDS));
+	std::vector<TraceRecord> copy;
+	copy.reserve(end - begin);
+	for (size_t pos = begin; pos != end; ++pos)
+		copy.push_back(records[pos % MAX_PERFORMANCE_RECORDS]);
+	// Like seqlock, loop thread could overwrite oldest records while we were copying them (+1 for record being written)
+	const size_t new_end = write_pos.load(std::memory_order_acquire) + 1;
+	const size_t skip    = new_end - begin > MAX_PERFORMANCE_RECORDS ? std::min(copy.size(), new_end - begin - MAX_PERFORMANCE_RECORDS) : 0;
+	// Ticks are converted using average rate since construction, good enough for invariant TSC
+	const uint64_t now_ticks = trace_ticks();
+	const auto now_tm        = steady_clock::now();
+	const double rate        = now_ticks == start_ticks ? 0 : double((now_tm - start_tm).count()) / double(now_ticks - start_ticks);
+	result.reserve(copy.size() - skip);
+	for (size_t i = skip; i != copy.size(); ++i) {
+		const auto &rec = copy[i];
+		const auto tm   = start_tm + steady_clock::duration(static_cast<steady_clock::rep>(double(int64_t(rec.ticks - start_ticks)) * rate));
+		result.emplace_back(tm, rec.event_type, rec.fd, rec.count);
+	}
+#endif
+	return result;
 }
 
 CRAB_INLINE void PerformanceStats::print_records(std::ostream &out) {
+	const auto performance = get_records();
 	for (const auto &p : performance) {
 		auto mksec = std::chrono::duration_cast<std::chrono::microseconds>(p.tm.time_since_epoch()).count();
 		auto sec   = mksec / 1000000;
@@ -29,6 +131,54 @@ CRAB_INLINE void PerformanceStats::print_records(std::ostream &out) {
 	clear_records();
 }
 
+CRAB_INLINE void PerformanceStats::write_chrome_trace(std::ostream &out, int tid) const {
+	const auto performance = get_records();
+	auto ts                = [](steady_clock::time_point tm) -> double {
+		return std::chrono::duration<double, std::micro>(tm.time_since_epoch()).count();
+	};
+	const auto flags     = out.flags();
+	const auto precision = out.precision();
+	out << std::fixed;
+	out.precision(3);
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	for (size_t i = 0; i != performance.size(); ++i) {
+		const auto &p = performance[i];
+		out << (first ? "\n" : ",\n");
+		first = false;
+		// Names are literals from our code or user code, so we do not escape them
+		if (i + 1 != performance.size()) {
+			const auto &r        = performance[i + 1];
+			const std::string rn = r.event_type;
+			if (rn.size() == std::strlen(p.event_type) + 3 && rn.compare(0, 2, "R(") == 0 &&
+			    rn.compare(2, rn.size() - 3, p.event_type) == 0 && r.fd == p.fd) {
+				out << "{\"name\":\"" << p.event_type << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << ts(p.tm)
+				    << ",\"dur\":" << (ts(r.tm) - ts(p.tm)) << ",\"args\":{\"fd\":" << p.fd << ",\"count\":" << p.count
+				    << ",\"result\":" << r.count << "}}";
+				i += 1;
+				continue;
+			}
+		}
+		out << "{\"name\":\"" << p.event_type << "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << ts(p.tm)
+		    << ",\"args\":{\"fd\":" << p.fd << ",\"count\":" << p.count << "}}";
+	}
+	out << "\n],\"displayTimeUnit\":\"ns\"}" << std::endl;
+	out.flags(flags);
+	out.precision(precision);
+}
+
+CRAB_INLINE void PerformanceStats::print_histograms(std::ostream &out) const {
+	auto print = [&](const char *name, const Histogram &histogram) {
+		const auto snapshot = histogram.snapshot();
+		out << name << " count=" << snapshot.total << " p50=" << snapshot.percentile(0.5) << " p99=" << snapshot.percentile(0.99)
+		    << " p999=" << snapshot.percentile(0.999) << " max=" << snapshot.max_value() << std::endl;
+	};
+	print("POLL_WAIT_nanos", POLL_WAIT_nanos);
+	print("CALLABLE_nanos", CALLABLE_nanos);
+	print("TIMER_LATE_nanos", TIMER_LATE_nanos);
+	print("EVENTS_PER_POLL", EVENTS_PER_POLL);
+}
+
 CRAB_INLINE Address::Address(const std::string &ip, uint16_t port) {
 	if (!parse(*this, ip, port))
 		if (!parse(*this, ip, port))
@@ -50,6 +200,81 @@ CRAB_INLINE bool Address::parse(Address &address, const std::string &ip_port) {
 
 CRAB_INLINE std::ostream &operator<<(std::ostream &os, const Address &msg) { return os << msg.get_address() << ":" << msg.get_port(); }
 
+CRAB_INLINE steady_clock::duration Timer::to_duration(double seconds) {
+	if (seconds <= 0)
+		return steady_clock::duration::zero();
+	const double ticks = seconds * steady_clock::period::den / steady_clock::period::num;
+	if (ticks >= double(steady_clock::duration::max().count()))
+		return steady_clock::duration::max();
+	return steady_clock::duration{static_cast<steady_clock::duration::rep>(ticks)};
+}
+
+CRAB_INLINE steady_clock::time_point Timer::coalesce(steady_clock::time_point time_point, steady_clock::duration slack) {
+	if (slack.count() <= 0)
+		return time_point;
+	auto granularity = static_cast<uint64_t>(slack.count());  // Smear bits, then keep highest one
+	granularity |= granularity >> 1;
+	granularity |= granularity >> 2;
+	granularity |= granularity >> 4;
+	granularity |= granularity >> 8;
+	granularity |= granularity >> 16;
+	granularity |= granularity >> 32;
+	granularity    = (granularity >> 1) + 1;
+	const auto rep = time_point.time_since_epoch().count();
+	if (rep < 0 || uint64_t(std::numeric_limits<steady_clock::duration::rep>::max() - rep) < granularity)
+		return time_point;  // We do not wish to overflow time point
+	const auto rounded = (static_cast<uint64_t>(rep) + granularity - 1) & ~(granularity - 1);
+	return steady_clock::time_point(steady_clock::duration{static_cast<steady_clock::duration::rep>(rounded)});
+}
+
+CRAB_INLINE void Timer::once(double delay_seconds, double slack_seconds) { once(to_duration(delay_seconds), to_duration(slack_seconds)); }
+
+CRAB_INLINE void Timer::once(steady_clock::duration delay, steady_clock::duration slack) {
+	const auto now = RunLoop::current()->now();
+	if (delay.count() <= 0)
+		once_at(now);
+	else if (delay >= steady_clock::time_point::max() - now)
+		once_at(steady_clock::time_point::max());
+	else
+		once_at(now + delay, slack);
+}
+
+CRAB_INLINE void Timer::once_at(steady_clock::time_point time_point, steady_clock::duration slack) { once_at(coalesce(time_point, slack)); }
+
+CRAB_INLINE Deadline::Deadline(steady_clock::duration duration, Handler &&cb)
+    : queue(RunLoop::current()->deadline_queue(duration)), a_handler(std::move(cb)) {}
+
+CRAB_INLINE void Deadline::arm() { queue.arm(*this); }
+
+CRAB_INLINE DeadlineQueue::DeadlineQueue(steady_clock::duration duration) : duration(duration), timer([this]() { on_timer(); }) {}
+
+CRAB_INLINE void DeadlineQueue::arm(Deadline &deadline) {
+	deadline.queue_node.unlink();
+	deadline.fire_time = RunLoop::current()->now() + duration;
+	deadlines.push_back(deadline);
+	if (!timer.is_set())  // Otherwise timer is set for earlier deadline, and will be reset for the next one
+		timer.once_at(deadline.fire_time, duration / SLACK_FRACTION);
+}
+
+CRAB_INLINE void DeadlineQueue::on_timer() {
+	const auto now = RunLoop::current()->now();
+	// Like with timers, handlers are called one by one, so is_set() is true for deadlines not yet fired
+	while (!deadlines.empty() && deadlines.front().fire_time <= now) {
+		Deadline &deadline = deadlines.front();
+		deadline.queue_node.unlink();
+		deadline.a_handler();
+	}
+	if (!deadlines.empty())
+		timer.once_at(deadlines.front().fire_time, duration / SLACK_FRACTION);
+}
+
+CRAB_INLINE DeadlineQueue &RunLoop::deadline_queue(steady_clock::duration duration) {
+	auto &queue = deadline_queues[duration.count()];
+	if (!queue)
+		queue.reset(new DeadlineQueue(duration));
+	return *queue;
+}
+
 #if !CRAB_IMPL_LIBEV && !CRAB_IMPL_CF
 
 CRAB_INLINE Idle::Idle(Handler &&cb) : a_handler(std::move(cb)) { set_active(true); }
@@ -77,7 +302,7 @@ CRAB_INLINE bool Idle::is_active() const { return idle_node.in_list(); }
 
 #endif
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_WINDOWS
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_WINDOWS
 
 CRAB_INLINE void Callable::add_pending_callable(bool can_read, bool can_write) {
 	this->can_read  = this->can_read || can_read;
@@ -87,7 +312,48 @@ CRAB_INLINE void Callable::add_pending_callable(bool can_read, bool can_write) {
 
 namespace details {
 
-CRAB_INLINE bool RunLoopLinks::process_timer(int &timeout_ms) {
+#if CRAB_TIMER_WHEEL
+
+CRAB_INLINE uint64_t RunLoopLinks::wheel_tick_floor(steady_clock::time_point tp) {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count());
+}
+
+CRAB_INLINE uint64_t RunLoopLinks::wheel_tick_ceil(steady_clock::time_point tp) {
+	const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch());
+	return static_cast<uint64_t>(ms.count()) + (ms < tp.time_since_epoch() ? 1 : 0);
+}
+
+CRAB_INLINE bool RunLoopLinks::process_timer(steady_clock::duration &timeout, PerformanceStats &stats) {
+	if (active_timers.empty())
+		return false;
+	active_timers.advance(wheel_tick_floor(now));
+	// Expired timers have fire_time <= tick <= now, so we never fire early
+	while (active_timers.has_expired()) {
+		Timer &timer = active_timers.front_expired();
+		active_timers.erase(timer);
+		if (timer.moved_fire_time > now) {  // Timer was moved far enough without rescheduling
+			timer.fire_time  = timer.moved_fire_time;
+			timer.wheel_tick = wheel_tick_ceil(timer.fire_time);
+			active_timers.insert(timer);
+			continue;
+		}
+		// See comment in heap version below on why we fire 1 timer at a time
+		stats.TIMER_LATE_nanos.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - timer.fire_time).count()));
+		timer.a_handler();
+		return true;
+	}
+	uint64_t next_tick = std::numeric_limits<uint64_t>::max();
+	active_timers.next_tick(next_tick);
+	// Lower bound, if we wake up earlier than some timer, we will simply cascade and sleep again
+	if (next_tick - active_timers.current_tick() >= uint64_t(RunLoop::MAX_SLEEP_MS))
+		return false;
+	timeout = steady_clock::time_point(std::chrono::milliseconds(next_tick)) - now;  // tick starts after now
+	return false;
+}
+
+#else
+
+CRAB_INLINE bool RunLoopLinks::process_timer(steady_clock::duration &timeout, PerformanceStats &stats) {
 	if (active_timers.empty())
 		return false;
 	while (true) {
@@ -105,6 +371,7 @@ CRAB_INLINE bool RunLoopLinks::process_timer(int &timeout_ms) {
 			// This would break app logic if timers are used as a logic state holders (which is
 			// useful and common), what is worse the probability of bug will be very low, so those
 			// problems would be very hard to debug.
+			stats.TIMER_LATE_nanos.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - timer.fire_time).count()));
 			timer.a_handler();
 			return true;
 		}
@@ -112,31 +379,91 @@ CRAB_INLINE bool RunLoopLinks::process_timer(int &timeout_ms) {
 		const auto now_plus_max_sleep = now + std::chrono::milliseconds(RunLoop::MAX_SLEEP_MS);
 		if (timer.fire_time >= now_plus_max_sleep)
 			return false;
-		timeout_ms = 1 + static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(timer.fire_time - now).count());
-		// crude way of rounding up, we do not want to wake loop up BEFORE fire_time.
-		// Moreover, 0 means "poll" and we do not want to poll for 0.9 msec waiting for timer
+		timeout = timer.fire_time - now;  // RunLoop rounds it up unless precise timers are set
 		break;
 	}
 	return false;
 }
 
-CRAB_INLINE void RunLoopLinks::call_watcher(Watcher *watcher) {
-	std::unique_lock<std::mutex> lock(mutex);
-	fired_objects.push_back(*watcher);
+#endif
+
+CRAB_INLINE void PostQueue::push(Handler &&handler) {
+	if (!has_overflow.load() && ring.push(handler))
+		return;
+	std::unique_lock<std::mutex> lock(overflow_mutex);
+	overflow.push_back(std::move(handler));
+	has_overflow.store(true);
+}
+
+CRAB_INLINE bool PostQueue::empty() const { return ring.empty() && !has_overflow.load(); }
+
+CRAB_INLINE void PostQueue::run_all() {
+	// Handlers posted by handlers are also run, but we limit pass, so that loop cannot be starved
+	Handler handler;
+	for (size_t i = 0; i != CAPACITY && ring.pop(handler); ++i) {
+		handler();
+		handler = nullptr;
+	}
+	if (!has_overflow.load(std::memory_order_relaxed) || !ring.empty())
+		return;  // Ring must be empty, before older handlers from overflow can run
+	std::deque<Handler> handlers;
+	{
+		std::unique_lock<std::mutex> lock(overflow_mutex);
+		handlers.swap(overflow);
+		has_overflow.store(false);
+	}
+	for (; !handlers.empty(); handlers.pop_front())
+		handlers.front()();
+}
+
+CRAB_INLINE bool RunLoopLinks::call_watcher(Watcher *watcher) {
+	watcher->called.store(true);
+	if (watcher->in_called_list.exchange(true))
+		return false;  // Whoever pushed it, also took care of wakeup
+	Watcher *head = called_watchers.load(std::memory_order_relaxed);
+	do {
+		watcher->called_next = head;
+	} while (!called_watchers.compare_exchange_weak(head, watcher));
+	// Pairs with prepare_to_sleep(), either loop sees our watcher, or we see loop sleeping
+	return sleeping.exchange(false);
 }
 
 CRAB_INLINE void RunLoopLinks::cancel_called_watcher(Watcher *watcher) {
-	std::unique_lock<std::mutex> lock(mutex);
-	watcher->fired_objects_node.unlink();
+	watcher->called.store(false);
+	// Watcher cannot be removed from the middle of lock-free stack, so if it is going to be destroyed,
+	// we empty the stack. Other watchers from the stack are triggered as usual.
+	if (watcher->in_called_list.load())
+		trigger_cross_thread_calls();
 }
 
-CRAB_INLINE void RunLoopLinks::trigger_called_watchers() {
-	std::unique_lock<std::mutex> lock(mutex);
-	while (!fired_objects.empty()) {
-		Watcher &watcher = fired_objects.front();
-		watcher.fired_objects_node.unlink();
-		triggered_callables.push_back(watcher.a_handler);
+CRAB_INLINE void RunLoopLinks::trigger_cross_thread_calls() {
+	if (!posted.empty())
+		triggered_callables.push_back(posted_callable);
+	if (called_watchers.load(std::memory_order_relaxed) == nullptr)
+		return;  // Fast path, called on every iteration
+	Watcher *head = called_watchers.exchange(nullptr);
+	Watcher *prev = nullptr;
+	while (head) {  // Stack is LIFO, reverse to trigger in order of calls
+		Watcher *next     = head->called_next;
+		head->called_next = prev;
+		prev              = head;
+		head              = next;
 	}
+	while (prev) {
+		Watcher *next = prev->called_next;  // Must be read before in_called_list is cleared, then watcher can be pushed again
+		prev->in_called_list.store(false);
+		if (prev->called.exchange(false))
+			triggered_callables.push_back(prev->a_handler);
+		prev = next;
+	}
+}
+
+CRAB_INLINE bool RunLoopLinks::prepare_to_sleep() {
+	sleeping.store(true);
+	if (called_watchers.load() == nullptr && posted.empty())
+		return true;
+	sleeping.store(false);
+	return false;
 }
 }  // namespace details
 
@@ -145,23 +472,98 @@ CRAB_INLINE void RunLoop::cancel() {
 	wakeup();
 }
 
+CRAB_INLINE int RunLoop::timeout_ms(steady_clock::duration timeout) {
+	// we do not want to wake loop up BEFORE fire_time. Moreover, 0 means "poll"
+	// and we do not want to poll for 0.9 msec waiting for timer
+	const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout);
+	return static_cast<int>(ms.count()) + (ms < timeout ? 1 : 0);
+}
+
+CRAB_INLINE bool RunLoop::busy_poll(steady_clock::duration timeout) {
+	const auto spin_until  = links.now + busy_poll_duration;
+	const auto timer_until = links.now + timeout;
+	while (true) {
+		if (links.has_cross_thread_calls())
+			links.trigger_cross_thread_calls();  // No syscall needed
+		else
+			step(steady_clock::duration::zero());
+		links.now = fast_now();
+		if (!links.triggered_callables.empty() || links.quit) {
+			stats.BUSY_POLL_HIT_count += 1;
+			return true;
+		}
+		if (links.now >= timer_until)
+			return true;  // We do not spin past the next timer, neither hit nor miss
+		if (links.now >= spin_until) {
+			stats.BUSY_POLL_MISS_count += 1;
+			return false;
+		}
+	}
+}
+
+CRAB_INLINE void RunLoop::post(Handler &&handler) {
+	links.posted.push(std::move(handler));
+	if (links.sleeping.exchange(false))
+		wakeup();
+}
+
+CRAB_INLINE void RunLoop::post(std::vector<Handler> &&handlers) {
+	for (auto &handler : handlers)
+		links.posted.push(std::move(handler));
+	handlers.clear();
+	if (links.sleeping.exchange(false))
+		wakeup();
+}
+
 CRAB_INLINE void RunLoop::run() {
-	links.now = steady_clock::now();
+	links.now        = sync_now();
+	bool spin_missed = false;  // after a miss, we block, but spin again once something is done
+	auto mark        = links.now;  // end of previous activity, so we need single now() per handler for histograms
+	auto nanos       = [](steady_clock::duration d) -> uint64_t {
+		// FastClock can step back by few nanoseconds when re-anchoring
+		return d.count() <= 0 ? 0 : static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+	};
 	while (!links.quit) {
 		if (!links.triggered_callables.empty()) {
 			Callable &callable = links.triggered_callables.front();
 			callable.triggered_callables_node.unlink();
 			callable.handler();
+			const auto finished = fast_now();
+			stats.CALLABLE_nanos.record(nanos(finished - mark));
+			mark        = finished;
+			spin_missed = false;
 			continue;
 		}
-		int timeout_ms = MAX_SLEEP_MS;
-		if (links.process_timer(timeout_ms))
+		steady_clock::duration timeout = std::chrono::milliseconds(MAX_SLEEP_MS);
+		if (links.process_timer(timeout, stats)) {
+			const auto finished = fast_now();
+			stats.CALLABLE_nanos.record(nanos(finished - mark));
+			mark        = finished;
+			spin_missed = false;
 			continue;
+		}
 		// Nothing triggered and no timers here
+		if (idle_handlers.empty() && busy_poll_duration.count() > 0 && !spin_missed) {
+			if (!busy_poll(timeout))
+				spin_missed = true;
+			mark = links.now;
+			continue;  // Timers must be processed with updated now
+		}
 		if (idle_handlers.empty()) {
-			step(timeout_ms);  // Just waiting
+			// Just waiting, if watchers were called, we still poll, so they cannot starve sockets
+			const bool blocking = links.prepare_to_sleep();
+			step(blocking ? timeout : steady_clock::duration::zero());
+			links.finish_sleep();
+			links.trigger_cross_thread_calls();
+			if (blocking) {
+				links.now = sync_now();  // After blocking, TSC extrapolation would be too long anyway
+				stats.POLL_WAIT_nanos.record(nanos(links.now - mark));
+				mark = links.now;
+				continue;
+			}
 		} else {
-			step(0);  // Poll, beware, both lists in a line below could change as a result
+			step(steady_clock::duration::zero());  // Poll, beware, both lists in a line below could change as a result
+			links.trigger_cross_thread_calls();
 			if (links.triggered_callables.empty() && !idle_handlers.empty()) {
 				// Nothing triggered during poll, time for idle handlers to run
 				Idle &idle = idle_handlers.front();
@@ -171,7 +573,8 @@ CRAB_INLINE void RunLoop::run() {
 				idle.a_handler();
 			}
 		}
-		links.now = steady_clock::now();
+		links.now = fast_now();
+		mark      = links.now;
 		// Runloop optimizes # of calls to now() because those can be slow
 	}
 	links.quit = false;
@@ -179,6 +582,22 @@ CRAB_INLINE void RunLoop::run() {
 
 CRAB_INLINE steady_clock::time_point RunLoop::now() const { return links.now; }
 
+CRAB_INLINE steady_clock::time_point RunLoop::fast_now() {
+#if CRAB_TSC_CLOCK
+	return fast_clock.now();
+#else
+	return steady_clock::now();
+#endif
+}
+
+CRAB_INLINE steady_clock::time_point RunLoop::sync_now() {
+#if CRAB_TSC_CLOCK
+	return fast_clock.sync();
+#else
+	return steady_clock::now();
+#endif
+}
+
 CRAB_INLINE Thread::Thread(std::function<void()> &&fun)
 #if __cplusplus >= 201402L
     : th([this, fun = std::move(fun)] {
@@ -214,6 +633,194 @@ CRAB_INLINE void Thread::cancel() {
 		run_loop_ptr->cancel();
 }
 
+CRAB_INLINE RunLoopGroup::RunLoopGroup(const Settings &settings) : settings(settings) {
+	size_t threads_count = settings.threads != 0 ? settings.threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+	auto cpus            = settings.cpus;
+	if (settings.steer_by_incoming_cpu && cpus.empty())
+		for (size_t i = 0; i != threads_count; ++i)
+			cpus.push_back(static_cast<int>(i));
+	for (size_t i = 0; i != threads_count; ++i)
+		thread_cpus.push_back(cpus.empty() ? -1 : cpus.at(i % cpus.size()));
+}
+
+CRAB_INLINE void RunLoopGroup::start(std::function<void(size_t index)> &&f) {
+	if (!threads.empty())
+		throw std::logic_error{"RunLoopGroup::start must be called only once"};
+	fun = std::move(f);
+	for (size_t i = 0; i != thread_cpus.size(); ++i) {
+		threads.emplace_back(new Thread([this, i]() {
+			if (thread_cpus.at(i) >= 0 && !pin_current_thread(thread_cpus.at(i)))
+				std::cout << "RunLoopGroup failed to pin thread " << i << " to cpu " << thread_cpus.at(i) << std::endl;
+			bool running        = false;
+			auto set_running = [this, &running]() {
+				if (running)
+					return;
+				running = true;
+				std::unique_lock<std::mutex> lock(mu);
+				running_count += 1;
+				cond.notify_one();
+			};
+			RunLoop::current()->post(set_running);  // First iteration of loop
+			scope_exit defer(set_running);          // If fun returns (or throws) without running loop
+			this->fun(i);
+		}));
+		std::unique_lock<std::mutex> lock(mu);
+		cond.wait(lock, [&]() -> bool { return running_count == i + 1; });
+	}
+}
+
+CRAB_INLINE RunLoopGroup::~RunLoopGroup() {
+	cancel();
+	threads.clear();
+}
+
+CRAB_INLINE void RunLoopGroup::cancel() {
+	for (auto &th : threads)
+		th->cancel();
+}
+
+CRAB_INLINE WorkerPool::WorkerPool(size_t threads) {
+	const size_t count = threads != 0 ? threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+	for (size_t i = 0; i != count; ++i)
+		workers.emplace_back(new Worker{});
+	for (size_t i = 0; i != count; ++i)
+		workers[i]->th = std::thread([this, i]() { worker_fun(i); });
+}
+
+CRAB_INLINE WorkerPool::~WorkerPool() {
+	quit = true;
+	for (auto &w : workers) {
+		std::unique_lock<std::mutex> lock(w->mu);
+		w->cond.notify_one();
+	}
+	for (auto &w : workers)
+		w->th.join();
+	for (auto &w : workers)
+		w->tasks.clear();  // Destroy handlers not yet started on this thread, not on workers
+}
+
+CRAB_INLINE void WorkerPool::submit(Handler &&work, Handler &&completion) {
+	Task task;
+	task.work       = std::move(work);
+	task.completion = std::move(completion);
+	task.loop       = RunLoop::current();
+	push(std::move(task));
+}
+
+CRAB_INLINE void WorkerPool::submit(Handler &&work) {
+	Task task;
+	task.work = std::move(work);
+	push(std::move(task));
+}
+
+CRAB_INLINE void WorkerPool::push(Task &&task) {
+	Worker &worker = *workers[next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+	bool was_sleeping = false;
+	{
+		std::unique_lock<std::mutex> lock(worker.mu);
+		worker.tasks.push_back(std::move(task));
+		was_sleeping = worker.sleeping;
+		if (was_sleeping)
+			worker.cond.notify_one();
+	}
+	if (was_sleeping || sleeping_count.load() == 0)
+		return;
+	// Owner is busy, wake single idle worker to steal. Thieves are not needed for correctness, so if it is
+	// going to sleep right now, we do not care, owner will run task itself
+	for (auto &w : workers) {
+		std::unique_lock<std::mutex> lock(w->mu, std::try_to_lock);
+		if (lock.owns_lock() && w->sleeping) {
+			w->cond.notify_one();
+			return;
+		}
+	}
+}
+
+CRAB_INLINE bool WorkerPool::steal(size_t index, Task &task) {
+	for (size_t i = 1; i != workers.size(); ++i) {
+		Worker &victim = *workers[(index + i) % workers.size()];
+		std::unique_lock<std::mutex> lock(victim.mu, std::try_to_lock);  // Contended victim is not worth waiting for
+		if (!lock.owns_lock() || victim.tasks.empty())
+			continue;
+		task = std::move(victim.tasks.back());
+		victim.tasks.pop_back();
+		steal_count.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+CRAB_INLINE void WorkerPool::worker_fun(size_t index) {
+	Worker &worker = *workers[index];
+	std::vector<std::pair<RunLoop *, std::vector<Handler>>> completions;  // few loops per batch, so vector is fine
+	size_t completions_count = 0;
+	steady_clock::time_point batch_start;
+	auto flush_completions = [&]() {
+		for (auto &c : completions)
+			c.first->post(std::move(c.second));
+		completions.clear();
+		completions_count = 0;
+	};
+	Task task;
+	while (!quit.load(std::memory_order_relaxed)) {
+		bool found = false;
+		{
+			std::unique_lock<std::mutex> lock(worker.mu);
+			if (!worker.tasks.empty()) {
+				task = std::move(worker.tasks.front());
+				worker.tasks.pop_front();
+				found = true;
+			}
+		}
+		if (found || steal(index, task)) {
+			const auto work_start = steady_clock::now();
+			task.work();
+			if (task.loop) {
+				auto it = std::find_if(completions.begin(), completions.end(),
+				    [&](const std::pair<RunLoop *, std::vector<Handler>> &c) -> bool { return c.first == task.loop; });
+				if (it == completions.end())
+					it = completions.emplace(completions.end(), task.loop, std::vector<Handler>{});
+				it->second.push_back(std::move(task.completion));
+				if (completions_count++ == 0)
+					batch_start = work_start;
+				// Long work means next task is probably long as well, so we must not hold finished work
+				const auto now       = steady_clock::now();
+				const auto max_delay = std::chrono::microseconds(MAX_COMPLETION_DELAY_US);
+				if (completions_count >= MAX_COMPLETION_BATCH || now - work_start >= max_delay || now - batch_start >= max_delay)
+					flush_completions();
+			}
+			task = Task{};
+			continue;
+		}
+		flush_completions();  // No more work for now, so latency matters more than batching
+		std::unique_lock<std::mutex> lock(worker.mu);
+		if (!worker.tasks.empty() || quit)
+			continue;
+		worker.sleeping = true;
+		sleeping_count.fetch_add(1);
+		worker.cond.wait(lock);
+		sleeping_count.fetch_sub(1);
+		worker.sleeping = false;
+	}
+	flush_completions();  // Work is done, so completion must run, and on its loop thread
+}
+
+CRAB_INLINE bool Thread::post(Handler &&handler) {
+	std::unique_lock<std::mutex> lock(mu);
+	if (!run_loop_ptr)
+		return false;
+	run_loop_ptr->post(std::move(handler));
+	return true;
+}
+
+CRAB_INLINE bool Thread::post(std::vector<Handler> &&handlers) {
+	std::unique_lock<std::mutex> lock(mu);
+	if (!run_loop_ptr)
+		return false;
+	run_loop_ptr->post(std::move(handlers));
+	return true;
+}
+
 CRAB_INLINE void Timer::once(double delay_seconds) {
 	const auto now = RunLoop::current()->links.now;
 	// We do not wish to overflow time point. Observation - std::chrono is a disaster, will do manually
@@ -261,6 +868,9 @@ CRAB_INLINE void Timer::once_at(steady_clock::time_point time_point) {
 	} else {
 		RunLoop::current()->links.active_timers.erase(*this);
 		moved_fire_time = fire_time = time_point;
+#if CRAB_TIMER_WHEEL
+		wheel_tick = details::RunLoopLinks::wheel_tick_ceil(time_point);
+#endif
 		RunLoop::current()->links.active_timers.insert(*this);
 	}
 }
@@ -269,7 +879,11 @@ CRAB_INLINE Timer::Timer(Handler &&cb) : a_handler(std::move(cb)) {}
 
 CRAB_INLINE Timer::~Timer() { cancel(); }
 
+#if CRAB_TIMER_WHEEL
+CRAB_INLINE bool Timer::is_set() const { return wheel_node.in_list(); }
+#else
 CRAB_INLINE bool Timer::is_set() const { return heap_index.in_heap(); }
+#endif
 
 CRAB_INLINE void Timer::cancel() { RunLoop::current()->links.active_timers.erase(*this); }
 
@@ -278,8 +892,8 @@ CRAB_INLINE Watcher::Watcher(Handler &&a_handler) : loop(RunLoop::current()), a_
 CRAB_INLINE Watcher::~Watcher() { cancel(); }
 
 CRAB_INLINE void Watcher::call() {
-	loop->links.call_watcher(this);
-	loop->wakeup();
+	if (loop->links.call_watcher(this))
+		loop->wakeup();
 }
 
 CRAB_INLINE void Watcher::cancel() {
@@ -308,24 +922,86 @@ private:
 			quit = true;
 			cond.notify_all();
 		}
-		if (dns_thread.joinable())
-			dns_thread.join();
+		for (auto &th : dns_threads)
+			th.join();
 	}
 
 	friend class ::crab::DNSResolver;
 
+	struct Lookup {
+		std::string host_name;
+		uint16_t port = 0;
+		bool ipv4     = false;
+		bool ipv6     = false;
+		IntrusiveList<DNSResolver, &DNSResolver::work_queue_node> waiting;  // can become empty due to cancel
+	};
+	struct CacheEntry {
+		std::vector<Address> names;
+		steady_clock::time_point expires;
+	};
+	static std::string make_key(const std::string &host_name, uint16_t port, bool ipv4, bool ipv6) {
+		return std::to_string(port) + (ipv4 ? "4" : "") + (ipv6 ? "6" : "") + ":" + host_name;
+	}
+
 	std::mutex dns_mutex;
 	bool quit = false;
-	IntrusiveList<DNSResolver, &DNSResolver::work_queue_node> work_queue;
-	DNSResolver *executing_request = nullptr;
+	DNSResolver::Settings settings;
+	std::map<std::string, Lookup> lookups;  // map nodes are stable, so resolvers can be linked into them
+	std::deque<std::string> work_queue;     // keys of lookups not yet taken by threads
+	std::map<std::string, CacheEntry> cache;
+	size_t idle_threads = 0;
 	std::condition_variable cond;
+	std::vector<std::thread> dns_threads;
 
-	std::thread dns_thread{&DNSWorker::worker_fun, this};
+	bool resolve(DNSResolver *resolver, const std::string &host_name, uint16_t port, bool ipv4, bool ipv6) {
+		// returns true if names were found in cache, called under lock
+		auto key = make_key(host_name, port, ipv4, ipv6);
+		auto cit = cache.find(key);
+		if (cit != cache.end()) {
+			if (cit->second.expires > steady_clock::now()) {
+				resolver->names = cit->second.names;
+				return true;
+			}
+			cache.erase(cit);
+		}
+		const bool new_lookup = lookups.find(key) == lookups.end();  // host_name can be empty, so cannot be a marker
+		auto &lookup          = lookups[key];
+		if (new_lookup) {
+			lookup.host_name = host_name;
+			lookup.port      = port;
+			lookup.ipv4      = ipv4;
+			lookup.ipv6      = ipv6;
+			work_queue.push_back(std::move(key));
+			// Idle threads already notified are still counted until they wake up, so compare with queue size
+			if (work_queue.size() > idle_threads && dns_threads.size() < std::max<size_t>(1, settings.threads))
+				dns_threads.emplace_back(&DNSWorker::worker_fun, this);
+			else
+				cond.notify_one();
+		}
+		lookup.waiting.push_back(*resolver);
+		return false;
+	}
+	void add_to_cache(const std::string &key, const std::vector<Address> &names) {  // called under lock
+		const double ttl = names.empty() ? settings.negative_ttl_sec : settings.positive_ttl_sec;
+		if (ttl <= 0)
+			return;
+		if (cache.size() >= settings.max_cache_entries) {
+			const auto now = steady_clock::now();
+			for (auto it = cache.begin(); it != cache.end();)
+				it = it->second.expires <= now ? cache.erase(it) : std::next(it);
+			if (cache.size() >= settings.max_cache_entries)
+				cache.clear();
+		}
+		auto &entry   = cache[key];
+		entry.names   = names;
+		entry.expires = steady_clock::now() + std::chrono::duration_cast<steady_clock::duration>(std::chrono::duration<double>(ttl));
+	}
 	void worker_fun() {
 #if CRAB_IMPL_BOOST
 		RunLoop runloop;  // boost sync resolve requires io_service
 #endif
 		while (true) {
+			std::string key;
 			std::string host_name;
 			uint16_t port = 0;
 			bool ipv4     = false;
@@ -335,24 +1011,35 @@ private:
 				if (quit)
 					return;
 				if (work_queue.empty()) {
+					idle_threads += 1;
 					cond.wait(lock);
+					idle_threads -= 1;
 					continue;
 				}
-				executing_request = &work_queue.front();
-				executing_request->work_queue_node.unlink();
-				host_name = std::move(executing_request->host_name);
-				port      = executing_request->port;
-				ipv4      = executing_request->ipv4;
-				ipv6      = executing_request->ipv6;
+				key = std::move(work_queue.front());
+				work_queue.pop_front();
+				auto lit = lookups.find(key);
+				if (lit == lookups.end())
+					continue;  // Defensive, each lookup is queued once and erased by thread which took it
+				host_name = lit->second.host_name;
+				port      = lit->second.port;
+				ipv4      = lit->second.ipv4;
+				ipv6      = lit->second.ipv6;
 			}
 			// resolve
 			auto names = DNSResolver::sync_resolve(host_name, port, ipv4, ipv6);
 			std::unique_lock<std::mutex> lock(dns_mutex);
-			if (!executing_request)
+			add_to_cache(key, names);
+			auto lit = lookups.find(key);
+			if (lit == lookups.end())
 				continue;
-			executing_request->names = std::move(names);
-			executing_request->ab.call();
-			executing_request = nullptr;
+			while (!lit->second.waiting.empty()) {
+				DNSResolver &resolver = lit->second.waiting.front();
+				resolver.work_queue_node.unlink();
+				resolver.names = names;
+				resolver.ab.call();
+			}
+			lookups.erase(lit);
 		}
 	}
 };
@@ -369,15 +1056,11 @@ CRAB_INLINE void DNSResolver::on_handler() {
 
 CRAB_INLINE void DNSResolver::resolve(const std::string &host_name, uint16_t port, bool ipv4, bool ipv6) {
 	cancel();
-	auto &w         = details::DNSWorker::get_instance();
-	resolving       = true;
-	this->host_name = host_name;
-	this->port      = port;
-	this->ipv4      = ipv4;
-	this->ipv6      = ipv6;
+	auto &w   = details::DNSWorker::get_instance();
+	resolving = true;
 	std::unique_lock<std::mutex> lock(w.dns_mutex);
-	w.work_queue.push_back(*this);
-	w.cond.notify_one();
+	if (w.resolve(this, host_name, port, ipv4, ipv6))
+		ab.call();  // Cache hit, no threads involved
 }
 
 CRAB_INLINE void DNSResolver::cancel() {
@@ -385,13 +1068,23 @@ CRAB_INLINE void DNSResolver::cancel() {
 		return;
 	auto &w = details::DNSWorker::get_instance();
 	std::unique_lock<std::mutex> lock(w.dns_mutex);
-	if (w.executing_request == this)
-		w.executing_request = nullptr;
-	work_queue_node.unlink();
+	work_queue_node.unlink();  // Lookup itself continues, result will be cached
 	ab.cancel();
 	resolving = false;
 }
 
+CRAB_INLINE void DNSResolver::set_settings(const Settings &settings) {
+	auto &w = details::DNSWorker::get_instance();
+	std::unique_lock<std::mutex> lock(w.dns_mutex);
+	w.settings = settings;
+}
+
+CRAB_INLINE void DNSResolver::clear_cache() {
+	auto &w = details::DNSWorker::get_instance();
+	std::unique_lock<std::mutex> lock(w.dns_mutex);
+	w.cache.clear();
+}
+
 CRAB_INLINE Address DNSResolver::sync_resolve_single(const std::string &host_name, uint16_t port) {
 	auto arr = sync_resolve(host_name, port, true, false);
 	if (!arr.empty())
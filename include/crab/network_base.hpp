@@ -12,11 +12,20 @@
 #include <vector>
 
 #include "crab_version.hpp"
+#include "histogram.hpp"
+#include "inplace_handler.hpp"
 #include "intrusive_heap.hpp"
 #include "intrusive_list.hpp"
+#include "intrusive_timer_wheel.hpp"
 #include "streams.hpp"
 #include "util.hpp"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
 // We use address_storage structure in crab::Address
 #if CRAB_IMPL_WINDOWS
 #include <winsock2.h>
@@ -24,7 +33,7 @@
 #undef ERROR
 #undef min
 #undef max
-#elif CRAB_IMPL_LIBEV || CRAB_IMPL_EPOLL || CRAB_IMPL_CF
+#elif CRAB_IMPL_LIBEV || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_CF
 #include <sys/socket.h>
 #elif CRAB_IMPL_KEVENT
 #include <sys/event.h>
@@ -39,7 +48,9 @@ namespace crab {
 
 using steady_clock = std::chrono::steady_clock;
 
-typedef std::function<void()> Handler;
+// Captures of lambdas passed to Timer, Watcher, sockets, etc. must fit, see inplace_handler.hpp
+// 32 bytes, but not less than std::function, so it can always be wrapped (48 bytes in libc++, 64 in MSVC)
+typedef InplaceHandler<(sizeof(std::function<void()>) > 32 ? sizeof(std::function<void()>) : 32)> Handler;
 inline void empty_handler() {}
 
 class RunLoop;
@@ -54,6 +65,53 @@ namespace details {
 class DNSWorker;
 }
 
+// Clock source for hot paths, reads TSC and converts to steady_clock::time_point with rate calibrated once
+// per process. To bound drift, TSC is only extrapolated from the last steady_clock reading (anchor) for up to
+// MAX_EXTRAPOLATION_MS, then clock re-anchors. Falls back to steady_clock if TSC is not invariant, kernel does not
+// use TSC as clocksource (Linux) or CPU is not x86. Not thread-safe, each thread (RunLoop) needs own instance.
+class FastClock {
+public:
+	enum { MAX_EXTRAPOLATION_MS = 4 };
+
+	FastClock() { sync(); }
+	steady_clock::time_point now() {
+		const Calibration &cal = calibration();
+		if (!cal.use_tsc)
+			return steady_clock::now();
+		const uint64_t delta = read_ticks() - anchor_ticks;
+		if (delta >= cal.max_delta_ticks)
+			return sync();
+		return anchor_tm + std::chrono::duration_cast<steady_clock::duration>(std::chrono::nanoseconds((delta * cal.nanos_mult) >> 32));
+	}
+	steady_clock::time_point sync() {  // reads steady_clock and re-anchors
+		const uint64_t before = read_ticks();
+		anchor_tm             = steady_clock::now();
+		anchor_ticks          = before + (read_ticks() - before) / 2;
+		return anchor_tm;
+	}
+	static bool is_tsc() { return calibration().use_tsc; }
+
+	static uint64_t read_ticks() {  // TSC where available, steady_clock ticks otherwise
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+private:
+	struct Calibration {
+		bool use_tsc             = false;
+		uint64_t nanos_mult      = 0;  // nanoseconds per tick in 32.32 fixed point
+		uint64_t max_delta_ticks = 0;  // MAX_EXTRAPOLATION_MS in ticks, also guarantees no overflow in now()
+	};
+	static const Calibration &calibration();
+	static bool tsc_is_reliable();
+
+	uint64_t anchor_ticks = 0;
+	steady_clock::time_point anchor_tm;
+};
+
 struct PerformanceRecord {
 	steady_clock::time_point tm;
 	const char *event_type = nullptr;  // Only literals, so recording is very fast
@@ -68,14 +126,28 @@ class PerformanceStats {
 public:
 	PerformanceStats();
 
-	// If you do not clear records periodically, push_record() becomes very fast NOP
-	// after MAX_PERFORMANCE_RECORDS events recorded.
-	enum { MAX_PERFORMANCE_RECORDS = 100000 };  // Arbitrary constant
-
-	void push_record(const char *event_type_literal, int fd, int count);  // Pass only literals here
-	const std::vector<PerformanceRecord> &get_records() const { return performance; }
-	void clear_records() { performance.clear(); }
+	// Records are kept only if compiled with CRAB_TRACING=1, otherwise push_record() is empty inline.
+	// Ring of records is overwritten, so it always contains last MAX_PERFORMANCE_RECORDS events.
+	enum { MAX_PERFORMANCE_RECORDS = 65536 };  // Must be power of 2, arbitrary constant
+
+	void push_record(const char *event_type_literal, int fd, int count) {  // Pass only literals here
+#if CRAB_TRACING
+		const size_t pos = write_pos.load(std::memory_order_relaxed);
+		TraceRecord &rec = records[pos % MAX_PERFORMANCE_RECORDS];
+		rec.ticks        = trace_ticks();
+		rec.event_type   = event_type_literal;
+		rec.fd           = fd;
+		rec.count        = count;
+		write_pos.store(pos + 1, std::memory_order_release);
+#endif
+	}
+	// Snapshot, oldest first. Can be called from other threads, records overwritten during the call are skipped
+	std::vector<PerformanceRecord> get_records() const;
+	void clear_records() { clear_pos.store(write_pos.load(std::memory_order_relaxed), std::memory_order_relaxed); }
 	void print_records(std::ostream &out);  // Also clears
+	// Chrome trace JSON, open in chrome://tracing or ui.perfetto.dev. Record "x" followed by "R(x)" become single
+	// duration event, others are instant events. tid distinguishes loops if several traces are merged
+	void write_chrome_trace(std::ostream &out, int tid = 0) const;
 
 	size_t RECV_count     = 0;
 	size_t RECV_size      = 0;
@@ -88,14 +160,37 @@ public:
 	size_t UDP_SEND_count = 0;
 	size_t UDP_SEND_size  = 0;
 
+	size_t BUSY_POLL_HIT_count  = 0;  // work appeared while spinning, blocking wait avoided
+	size_t BUSY_POLL_MISS_count = 0;  // spin budget exhausted, loop went to blocking wait
+
+	// Maintained by RunLoop::run, always on. Snapshot can be taken from other threads
+	Histogram POLL_WAIT_nanos;   // time blocked in epoll_wait/kevent/etc., non-blocking polls are not recorded
+	Histogram CALLABLE_nanos;    // run time of each triggered handler (sockets, watchers, posted handlers, timers)
+	Histogram TIMER_LATE_nanos;  // how late each Timer fires, measured by loop time, which is updated after each poll
+	Histogram EVENTS_PER_POLL;   // number of events returned by each poll
+	void print_histograms(std::ostream &out) const;
+
 private:
-	std::vector<PerformanceRecord> performance;
+#if CRAB_TRACING
+	static uint64_t trace_ticks() { return FastClock::read_ticks(); }  // converted to time only when records are read
+#endif
+	struct TraceRecord {
+		uint64_t ticks         = 0;
+		const char *event_type = nullptr;
+		int fd                 = 0;
+		int count              = 0;
+	};
+	std::unique_ptr<TraceRecord[]> records;
+	std::atomic<size_t> write_pos{0};  // written only by loop thread
+	std::atomic<size_t> clear_pos{0};
+	uint64_t start_ticks = 0;  // For conversion of ticks to steady_clock
+	steady_clock::time_point start_tm;
 };
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_LIBEV || CRAB_IMPL_WINDOWS
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV || CRAB_IMPL_WINDOWS
 
 struct Callable : private Nocopy {
-	explicit Callable(Handler &&handler) : handler(handler) {}
+	explicit Callable(Handler &&handler) : handler(std::move(handler)) {}
 	Handler handler;
 	IntrusiveNode<Callable> triggered_callables_node;
 	bool can_read  = false;
@@ -108,22 +203,29 @@ struct Callable : private Nocopy {
 	}
 	bool is_pending_callable() const { return triggered_callables_node.in_list(); }
 	void add_pending_callable(bool can_read, bool can_write);
+#if CRAB_IMPL_URING
+	~Callable();                   // io_uring poll holds reference to file, so must be removed explicitly
+	uint64_t uring_user_data = 0;  // slot + generation of poll registration, 0 if not registered
+#endif
 };
 
 namespace details {
 struct RunLoopLinks;
+#if CRAB_IMPL_URING
+struct URing;
+#endif
 }  // namespace details
 
 #else
 
 struct Callable : private Nocopy {
-	explicit Callable(Handler &&handler) : handler(handler) {}
+	explicit Callable(Handler &&handler) : handler(std::move(handler)) {}
 	Handler handler;
 };
 
 #endif
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_LIBEV
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
 
 namespace details {
 class FileDescriptor : private Nocopy {
@@ -135,6 +237,11 @@ public:
 	int get_value() const { return value; }
 	bool is_valid() const { return value >= 0; }
 	void swap(FileDescriptor &other) { std::swap(value, other.value); }
+	int release() {  // caller becomes owner
+		const int result = value;
+		value            = -1;
+		return result;
+	}
 
 private:
 	int value;
@@ -51,7 +51,10 @@ CRAB_INLINE RunLoop::RunLoop() : impl(new RunLoopImpl()) {
 	CurrentLoop::instance = this;
 }
 
-CRAB_INLINE RunLoop::~RunLoop() { CurrentLoop::instance = this; }
+CRAB_INLINE RunLoop::~RunLoop() {
+	deadline_queues.clear();
+	CurrentLoop::instance = this;
+}
 
 CRAB_INLINE void RunLoop::run() {
 	auto &io = impl->io;
@@ -104,6 +104,7 @@ CRAB_INLINE RunLoop::RunLoop() {
 }
 
 CRAB_INLINE RunLoop::~RunLoop() {
+	deadline_queues.clear();
 	CurrentLoop::instance = this;
 	CFRunLoopObserverInvalidate(idle_observer);
 	CFRelease(idle_observer);
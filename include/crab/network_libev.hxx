@@ -78,7 +78,10 @@ CRAB_INLINE RunLoop::RunLoop(DefaultLoop) : impl(new ev::default_loop{}) {
 	CurrentLoop::instance = this;
 }
 
-CRAB_INLINE RunLoop::~RunLoop() { CurrentLoop::instance = this; }
+CRAB_INLINE RunLoop::~RunLoop() {
+	deadline_queues.clear();
+	CurrentLoop::instance = this;
+}
 
 CRAB_INLINE void RunLoop::run() { impl->run(); }
 
@@ -4,9 +4,10 @@
 #include <sstream>
 #include "network.hpp"
 
-#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_LIBEV
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING || CRAB_IMPL_LIBEV
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include <arpa/inet.h>
@@ -24,6 +25,7 @@
 #include <sys/event.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 namespace crab { namespace details {
 constexpr int CRAB_MSG_NOSIGNAL = 0;
@@ -32,9 +34,48 @@ constexpr int CRAB_MSG_NOSIGNAL = 0;
 #endif
 
 #if defined(__linux__)
+#include <linux/errqueue.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
+#include <pthread.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/sendfile.h>
 #include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#if CRAB_IMPL_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#ifndef IORING_FEAT_RSRC_TAGS
+#define IORING_FEAT_RSRC_TAGS (1U << 10)  // Linux 5.13, same release as IORING_POLL_ADD_MULTI
+#endif
+#endif
+
+#ifndef __NR_epoll_pwait2
+#define __NR_epoll_pwait2 441  // Linux 5.11, same number on all architectures
+#endif
+#ifndef SO_ZEROCOPY  // Linux 4.14, older glibc headers do not have constants
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT  // Linux 4.18
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO  // Linux 5.0
+#define UDP_GRO 104
+#endif
+#ifndef SOF_TIMESTAMPING_OPT_TSONLY  // Linux 4.5
+#define SOF_TIMESTAMPING_OPT_TSONLY (1 << 11)
+#endif
 
 namespace crab { namespace details {
 constexpr int CRAB_MSG_NOSIGNAL = MSG_NOSIGNAL;
@@ -69,6 +110,9 @@ CRAB_INLINE void FileDescriptor::reset(int new_value) {
 
 constexpr int MAX_EVENTS = 512;
 
+// UDP_GRO segment size, SCM_TIMESTAMPNS, and SCM_TIMESTAMPING which kernel adds to received data when tx timestamps are on
+constexpr size_t RECV_CONTROL_SIZE = CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(3 * sizeof(timespec));
+
 CRAB_INLINE void setsockopt_int(int fd, int level, int optname, int value) {
 	check(setsockopt(fd, level, optname, &value, sizeof(value)) >= 0, "crab::setsockopt failed");
 }
@@ -80,6 +124,22 @@ CRAB_INLINE void set_nonblocking(int fd) {
 	check(fcntl(fd, F_SETFL, flags) >= 0, "crab::set_nonblocking set flags failed");
 }
 
+#if defined(__linux__)
+CRAB_INLINE void attach_reuseport_cpus(int fd, const std::vector<int> &cpus) {
+	// A = current CPU; if A == cpus[i] return i; for each i, then return A % cpus.size()
+	std::vector<sock_filter> code;
+	code.push_back(sock_filter{BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)});
+	for (size_t i = 0; i != cpus.size(); ++i) {
+		code.push_back(sock_filter{BPF_JMP | BPF_JEQ | BPF_K, 0, 1, static_cast<uint32_t>(cpus[i])});
+		code.push_back(sock_filter{BPF_RET | BPF_K, 0, 0, static_cast<uint32_t>(i)});
+	}
+	code.push_back(sock_filter{BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(cpus.size())});
+	code.push_back(sock_filter{BPF_RET | BPF_A, 0, 0, 0});
+	sock_fprog prog{static_cast<unsigned short>(code.size()), code.data()};
+	check(setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) >= 0, "crab::TCPAcceptor attach reuseport CBPF failed");
+}
+#endif
+
 CRAB_INLINE ip_mreqn fill_ip_mreqn(const std::string &adapter) {
 	ip_mreqn mreq{};
 	mreq.imr_address.s_addr = htonl(INADDR_ANY);
@@ -128,27 +188,68 @@ CRAB_INLINE bool write_datagram(const FileDescriptor &fd,
 	return true;
 }
 
+CRAB_INLINE void set_rx_timestamps(int fd) {
+#if defined(SO_TIMESTAMPNS)
+	setsockopt_int(fd, SOL_SOCKET, SO_TIMESTAMPNS, 1);
+#else
+	setsockopt_int(fd, SOL_SOCKET, SO_TIMESTAMP, 1);  // Mac OSX has microseconds only
+#endif
+}
+
+inline std::chrono::system_clock::time_point to_system_time(const timespec &ts) {
+	return std::chrono::system_clock::time_point{std::chrono::duration_cast<std::chrono::system_clock::duration>(
+	    std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec})};
+}
+
+CRAB_INLINE std::chrono::system_clock::time_point get_rx_timestamp(msghdr &msg) {
+	for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+#if defined(SO_TIMESTAMPNS)
+		if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_TIMESTAMPNS)
+			continue;
+		timespec ts{};
+		std::memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+		return to_system_time(ts);
+#else
+		if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_TIMESTAMP)
+			continue;
+		timeval tv{};
+		std::memcpy(&tv, CMSG_DATA(cm), sizeof(tv));
+		return std::chrono::system_clock::time_point{std::chrono::duration_cast<std::chrono::system_clock::duration>(
+		    std::chrono::seconds{tv.tv_sec} + std::chrono::microseconds{tv.tv_usec})};
+#endif
+	}
+	return std::chrono::system_clock::time_point{};
+}
+
 CRAB_INLINE optional<size_t> read_datagram(const FileDescriptor &fd,
     Callable &rw_handler,
     uint8_t *data,
     size_t count,
-    Address *peer_addr) {
+    Address *peer_addr,
+    std::chrono::system_clock::time_point *timestamp) {
 	if (!fd.is_valid() || !rw_handler.can_read)
 		return {};
 	Address in_addr;
-	socklen_t in_len = sizeof(sockaddr_storage);
 	RunLoop::current()->stats.UDP_RECV_count += 1;
 	RunLoop::current()->stats.push_record("recvfrom", fd.get_value(), int(count));
 	// On some Linux system, passing 0 to recvfrom results in EINVAL without reading datagram
 	// (while correct behaviour is reading, truncating to 0, returning EMSGSIZE).
 	// We protect clients semantic by reading into our own small buffer
-	uint8_t workaround_buffer[1];  // Uninitialized
-	ssize_t result = recvfrom(fd.get_value(),
-	    count ? data : workaround_buffer,
-	    count ? count : sizeof(workaround_buffer),
-	    details::CRAB_MSG_NOSIGNAL,
-	    in_addr.impl_get_sockaddr(),
-	    &in_len);
+	uint8_t workaround_buffer[1];        // Uninitialized
+	uint8_t control[RECV_CONTROL_SIZE];  // Uninitialized
+	struct iovec iov {};
+	iov.iov_base = count ? data : workaround_buffer;
+	iov.iov_len  = count ? count : sizeof(workaround_buffer);
+	struct msghdr msg {};
+	msg.msg_name    = in_addr.impl_get_sockaddr();
+	msg.msg_namelen = sizeof(sockaddr_storage);
+	msg.msg_iov     = &iov;
+	msg.msg_iovlen  = 1;
+	if (timestamp) {
+		msg.msg_control    = control;
+		msg.msg_controllen = sizeof(control);
+	}
+	ssize_t result = ::recvmsg(fd.get_value(), &msg, details::CRAB_MSG_NOSIGNAL);
 	if (result > static_cast<ssize_t>(count))  // Can only happen when reading into workaround_buffer
 		result = static_cast<ssize_t>(count);
 	RunLoop::current()->stats.push_record("R(recvfrom)", fd.get_value(), int(result));
@@ -173,10 +274,108 @@ CRAB_INLINE optional<size_t> read_datagram(const FileDescriptor &fd,
 	if (peer_addr) {
 		*peer_addr = in_addr;
 	}
+	if (timestamp)
+		*timestamp = get_rx_timestamp(msg);
 	RunLoop::current()->stats.UDP_RECV_size += result;
 	return result;
 }
 
+#if defined(__linux__)
+CRAB_INLINE void set_tx_timestamps(int fd) {
+	// Without OPT_TSONLY, kernel would loop copy of each datagram back, OPT_ID numbers sends so reports can be matched
+	setsockopt_int(fd, SOL_SOCKET, SO_TIMESTAMPING,
+	    SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY);
+}
+
+CRAB_INLINE bool read_tx_timestamp(const FileDescriptor &fd, UDPTransmitter::TxTimestamp &ts) {
+	while (fd.is_valid()) {
+		uint8_t control[CMSG_SPACE(3 * sizeof(timespec)) + CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_storage))];
+		struct msghdr msg {};
+		msg.msg_control    = control;
+		msg.msg_controllen = sizeof(control);
+		if (::recvmsg(fd.get_value(), &msg, MSG_ERRQUEUE) < 0)
+			return false;  // EAGAIN, error queue is empty
+		bool has_time = false;
+		bool has_id   = false;
+		for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+			if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPING) {
+				timespec tss[3]{};  // software, deprecated, hardware
+				std::memcpy(tss, CMSG_DATA(cm), sizeof(tss));
+				ts.timestamp = to_system_time(tss[0]);
+				has_time     = true;
+			}
+			const bool ip_err = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+			                    (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+			if (!ip_err)
+				continue;
+			sock_extended_err err{};
+			std::memcpy(&err, CMSG_DATA(cm), sizeof(err));
+			if (err.ee_origin != SO_EE_ORIGIN_TIMESTAMPING)
+				continue;
+			ts.id  = err.ee_data;
+			has_id = true;
+		}
+		if (has_time && has_id)
+			return true;
+		// Other reports are skipped
+	}
+	return false;
+}
+#endif
+
+inline UDPSocketSettings udp_settings_with_adapter(const std::string &adapter) {
+	UDPSocketSettings settings;
+	settings.adapter = adapter;
+	return settings;
+}
+
+CRAB_INLINE size_t write_datagrams(const FileDescriptor &fd,
+    Callable &rw_handler,
+    const ConstSlice *datagrams,
+    const Address *peer_addrs,
+    size_t count) {
+	size_t sent = 0;
+#if defined(__linux__)
+	while (sent != count && fd.is_valid() && rw_handler.can_write) {
+		struct mmsghdr msgs[UDPTransmitter::MAX_DATAGRAMS_BATCH];  // Uninitialized
+		struct iovec iovecs[UDPTransmitter::MAX_DATAGRAMS_BATCH];  // Uninitialized
+		const size_t batch = std::min<size_t>(count - sent, UDPTransmitter::MAX_DATAGRAMS_BATCH);
+		for (size_t i = 0; i != batch; ++i) {
+			iovecs[i].iov_base         = const_cast<uint8_t *>(datagrams[sent + i].data);  // sendmmsg promises not to modify data
+			iovecs[i].iov_len          = datagrams[sent + i].size;
+			msgs[i].msg_hdr            = msghdr{};
+			msgs[i].msg_hdr.msg_iov    = &iovecs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_len            = 0;
+			if (peer_addrs) {
+				msgs[i].msg_hdr.msg_name    = const_cast<sockaddr *>(peer_addrs[sent + i].impl_get_sockaddr());
+				msgs[i].msg_hdr.msg_namelen = peer_addrs[sent + i].impl_get_sockaddr_length();
+			}
+		}
+		RunLoop::current()->stats.UDP_SEND_count += 1;
+		RunLoop::current()->stats.push_record("sendmmsg", fd.get_value(), int(batch));
+		const int result = ::sendmmsg(fd.get_value(), msgs, static_cast<unsigned>(batch), details::CRAB_MSG_NOSIGNAL);
+		RunLoop::current()->stats.push_record("R(sendmmsg)", fd.get_value(), result);
+		if (result < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				rw_handler.can_write = false;
+				break;  // Will fire on_epoll_call in future automatically
+			}
+			sent += 1;  // Error is about the first datagram, we ignore it like write_datagram does
+			continue;
+		}
+		for (int i = 0; i != result; ++i)
+			RunLoop::current()->stats.UDP_SEND_size += msgs[i].msg_len;
+		sent += result;  // If less than batch, next call will report error of the next datagram
+	}
+#else
+	for (; sent != count; ++sent)
+		if (!write_datagram(fd, rw_handler, datagrams[sent].data, datagrams[sent].size, peer_addrs ? peer_addrs + sent : nullptr))
+			break;
+#endif
+	return sent;
+}
+
 }  // namespace details
 
 #if CRAB_IMPL_KEVENT
@@ -188,7 +387,7 @@ constexpr int EVFILT_USER_WAKEUP = 111;
 }  // namespace details
 
 CRAB_INLINE RunLoop::RunLoop()
-    : efd(kqueue(), "crab::RunLoop kqeueu failed"), wake_callable([this]() { links.trigger_called_watchers(); }) {
+    : efd(kqueue(), "crab::RunLoop kqeueu failed"), wake_callable([this]() { links.trigger_cross_thread_calls(); }) {
 	if (CurrentLoop::instance)
 		throw std::runtime_error{"RunLoop::RunLoop Only single RunLoop per thread is allowed"};
 	struct kevent changes {
@@ -205,7 +404,10 @@ CRAB_INLINE void RunLoop::impl_add_callable_fd(int fd, Callable *callable, bool
 	details::check(kevent(efd.get_value(), changes + (read ? 0 : 1), count, 0, 0, NULL) >= 0, "crab::RunLoop impl_kevent failed");
 }
 
-CRAB_INLINE RunLoop::~RunLoop() { CurrentLoop::instance = nullptr; }
+CRAB_INLINE RunLoop::~RunLoop() {
+	deadline_queues.clear();
+	CurrentLoop::instance = nullptr;
+}
 
 CRAB_INLINE void RunLoop::wakeup() {
 	struct kevent changeLst {
@@ -215,9 +417,12 @@ CRAB_INLINE void RunLoop::wakeup() {
 	details::check(kevent(efd.get_value(), &changeLst, 1, 0, 0, NULL) >= 0, "crab::RunLoop::wakeup");
 }
 
-CRAB_INLINE void RunLoop::step(int timeout_ms) {
+CRAB_INLINE void RunLoop::step(steady_clock::duration timeout) {
 	struct kevent events[details::MAX_EVENTS];
-	struct timespec tmout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000 * 1000};
+	if (!precise_timers)
+		timeout = std::chrono::milliseconds(timeout_ms(timeout));
+	const auto ns         = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+	struct timespec tmout = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
 	int n                 = kevent(efd.get_value(), 0, 0, events, details::MAX_EVENTS, &tmout);
 	if (n < 0) {
 		// We expect only EINTR here
@@ -227,6 +432,7 @@ CRAB_INLINE void RunLoop::step(int timeout_ms) {
 	stats.push_record("kevent", efd.get_value(), n);
 	stats.EPOLL_count += 1;
 	stats.EPOLL_size += n;
+	stats.EVENTS_PER_POLL.record(static_cast<uint64_t>(n));
 	for (int i = 0; i != n; ++i) {
 		auto &ev       = events[i];
 		Callable *impl = static_cast<Callable *>(ev.udata);
@@ -258,12 +464,20 @@ CRAB_INLINE bool Signal::running_under_debugger() { return false; }
 #elif CRAB_IMPL_EPOLL
 
 CRAB_INLINE RunLoop::RunLoop()
-    : efd(epoll_create1(0)), wake_fd(eventfd(0, EFD_NONBLOCK)), wake_callable([this]() {
+    : efd(epoll_create1(0))
+    , wake_fd(eventfd(0, EFD_NONBLOCK))
+    , timer_callable([this]() {
+	    uint64_t expirations = 0;
+	    if (read(timer_fd.get_value(), &expirations, sizeof(expirations)) < 0)
+		    return;  // EAGAIN if timer was re-armed before we read, nothing to do
+	    timer_fd_deadline = steady_clock::time_point{};  // Expired, so disarmed
+    })
+    , wake_callable([this]() {
 	    eventfd_t value = 0;
 	    eventfd_read(wake_fd.get_value(), &value);
 	    // TODO - check error
 
-	    links.trigger_called_watchers();
+	    links.trigger_cross_thread_calls();
     }) {
 	if (CurrentLoop::instance)
 		throw std::runtime_error{"RunLoop::RunLoop Only single RunLoop per thread is allowed"};
@@ -273,7 +487,11 @@ CRAB_INLINE RunLoop::RunLoop()
 	CurrentLoop::instance = this;
 }
 
-CRAB_INLINE RunLoop::~RunLoop() { CurrentLoop::instance = nullptr; }
+CRAB_INLINE RunLoop::~RunLoop() {
+	deadline_queues.clear();
+	zerocopy_lingers.reset();
+	CurrentLoop::instance = nullptr;
+}
 
 CRAB_INLINE void RunLoop::impl_add_callable_fd(int fd, Callable *callable, bool read, bool write) {
 	const uint32_t events = (read ? EPOLLIN : EPOLLET) | (write ? EPOLLOUT : EPOLLET) | EPOLLET;
@@ -281,9 +499,44 @@ CRAB_INLINE void RunLoop::impl_add_callable_fd(int fd, Callable *callable, bool
 	details::check(epoll_ctl(efd.get_value(), EPOLL_CTL_ADD, fd, &event) >= 0, "crab::add_epoll_callable failed");
 }
 
-CRAB_INLINE void RunLoop::step(int timeout_ms) {
+CRAB_INLINE void RunLoop::arm_timer_fd(steady_clock::time_point deadline) {
+	// Loop often sleeps several times until the same timer, and stale expiration would cause spurious wakeup,
+	// so we set timer only when deadline changes, and disarm it before sleeping without it
+	if (deadline == timer_fd_deadline)
+		return;
+	if (!timer_fd.is_valid()) {
+		timer_fd.reset(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK));  // steady_clock is CLOCK_MONOTONIC on Linux
+		details::check(timer_fd.is_valid(), "crab::RunLoop timerfd_create failed");
+		impl_add_callable_fd(timer_fd.get_value(), &timer_callable, true, false);
+	}
+	const auto ns          = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+	struct itimerspec spec = {};  // zero it_value disarms
+	spec.it_value          = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+	details::check(
+	    timerfd_settime(timer_fd.get_value(), TFD_TIMER_ABSTIME, &spec, nullptr) >= 0, "crab::RunLoop timerfd_settime failed");
+	timer_fd_deadline = deadline;
+}
+
+CRAB_INLINE void RunLoop::step(steady_clock::duration timeout) {
 	epoll_event events[details::MAX_EVENTS];
-	int n = epoll_wait(efd.get_value(), events, details::MAX_EVENTS, timeout_ms);
+	int n = -1;
+	if (precise_timers && timeout != steady_clock::duration::zero() && timeout < std::chrono::milliseconds(MAX_SLEEP_MS)) {
+		if (has_epoll_pwait2) {
+			const auto ns         = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+			struct timespec tmout = {static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+			n = static_cast<int>(syscall(__NR_epoll_pwait2, efd.get_value(), events, details::MAX_EVENTS, &tmout, nullptr, 0));
+			if (n < 0 && (errno == ENOSYS || errno == EPERM || errno == EINVAL))
+				has_epoll_pwait2 = false;  // Kernel older than 5.11 or seccomp profile unaware of it, fall back to timerfd
+		}
+		if (!has_epoll_pwait2) {
+			arm_timer_fd(links.now + timeout);  // epoll_wait below still has rounded up timeout, in case timer is late
+			n = epoll_wait(efd.get_value(), events, details::MAX_EVENTS, timeout_ms(timeout));
+		}
+	} else {
+		if (timeout != steady_clock::duration::zero() && timer_fd_deadline != steady_clock::time_point{})
+			arm_timer_fd(steady_clock::time_point{});  // Nearest timer was cancelled, so we must not wake up for it
+		n = epoll_wait(efd.get_value(), events, details::MAX_EVENTS, timeout_ms(timeout));
+	}
 	if (n < 0) {
 		// We expect only EINTR here
 		details::check(errno == EINTR, "RunLoop::step epoll_wait unexpected error");
@@ -292,6 +545,7 @@ CRAB_INLINE void RunLoop::step(int timeout_ms) {
 	stats.push_record("epoll_wait", efd.get_value(), n);
 	stats.EPOLL_count += 1;
 	stats.EPOLL_size += n;
+	stats.EVENTS_PER_POLL.record(static_cast<uint64_t>(n));
 	for (int i = 0; i != n; ++i) {
 		auto &ev               = events[i];
 		auto impl              = static_cast<Callable *>(ev.data.ptr);
@@ -307,8 +561,301 @@ CRAB_INLINE void RunLoop::wakeup() {
 	details::check(eventfd_write(wake_fd.get_value(), 1) >= 0, "crab::RunLoop wake_fd counter overflow");
 }
 
+#elif CRAB_IMPL_URING
+
+namespace details {
+
+// We talk to kernel directly via syscalls, so that crab still depends only on system headers (no liburing)
+// Registration of fd is a multishot poll, which is edge-triggered like our epoll impl. Registrations and
+// removals are only put into submission queue, then submitted together with waiting in a single
+// io_uring_enter() per RunLoop::step, so accepting or closing N sockets per iteration costs no extra syscalls.
+struct URing : private Nocopy {
+	enum : uint64_t { REMOVE_USER_DATA = ~uint64_t(0) };  // We ignore completions of removals
+	enum { SQ_ENTRIES = 1024, CQ_ENTRIES = 16384 };
+
+	URing();
+	~URing();
+
+	io_uring_sqe *get_sqe();  // submits if queue is full
+	int submit_and_wait(steady_clock::duration timeout);  // negative timeout means submit only, 0 means poll
+	// returns false if no completions ready
+	bool peek_cqe(io_uring_cqe *cqe);
+
+	uint64_t add_registration(Callable *callable, int fd, uint32_t events);
+	Callable *find_registration(uint64_t user_data) const;
+	void remove_registration(uint64_t user_data);
+	void submit_poll_add(uint64_t user_data);
+
+	FileDescriptor ring_fd;
+
+private:
+	struct Registration {
+		Callable *callable  = nullptr;  // nullptr for free slot
+		int fd              = -1;
+		uint32_t events     = 0;
+		uint32_t generation = 0;  // increments on each removal, so stale completions are ignored
+	};
+	std::vector<Registration> registrations;
+	std::vector<uint32_t> free_slots;
+
+	void *sq_ptr     = MAP_FAILED;
+	size_t sq_size   = 0;
+	void *sqes_ptr   = MAP_FAILED;
+	size_t sqes_size = 0;
+
+	unsigned *sq_head  = nullptr;
+	unsigned *sq_tail  = nullptr;
+	unsigned sq_mask   = 0;
+	io_uring_sqe *sqes = nullptr;
+
+	unsigned *cq_head  = nullptr;
+	unsigned *cq_tail  = nullptr;
+	unsigned cq_mask   = 0;
+	io_uring_cqe *cqes = nullptr;
+};
+
+CRAB_INLINE URing::URing() {
+	io_uring_params params{};
+	params.flags      = IORING_SETUP_CQSIZE;
+	params.cq_entries = CQ_ENTRIES;
+	ring_fd.reset(static_cast<int>(syscall(__NR_io_uring_setup, SQ_ENTRIES, &params)));
+	check(ring_fd.is_valid(), "crab::RunLoop io_uring_setup failed");
+	// Multishot poll has no feature bit, on 5.11 and 5.12 every poll would complete with -EINVAL,
+	// so we check for RSRC_TAGS, which appeared in the same 5.13 release
+	if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0 || (params.features & IORING_FEAT_EXT_ARG) == 0 ||
+	    (params.features & IORING_FEAT_NODROP) == 0 || (params.features & IORING_FEAT_RSRC_TAGS) == 0)
+		throw std::runtime_error{"crab::RunLoop io_uring impl requires Linux 5.13 or later"};
+	sq_size = std::max<size_t>(
+	    params.sq_off.array + params.sq_entries * sizeof(unsigned), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+	sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd.get_value(), IORING_OFF_SQ_RING);
+	check(sq_ptr != MAP_FAILED, "crab::RunLoop io_uring mmap of rings failed");
+	sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+	sqes_ptr  = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd.get_value(), IORING_OFF_SQES);
+	check(sqes_ptr != MAP_FAILED, "crab::RunLoop io_uring mmap of sqes failed");
+
+	auto base     = static_cast<char *>(sq_ptr);
+	sq_head       = reinterpret_cast<unsigned *>(base + params.sq_off.head);
+	sq_tail       = reinterpret_cast<unsigned *>(base + params.sq_off.tail);
+	sq_mask       = *reinterpret_cast<unsigned *>(base + params.sq_off.ring_mask);
+	sqes          = static_cast<io_uring_sqe *>(sqes_ptr);
+	auto sq_array = reinterpret_cast<unsigned *>(base + params.sq_off.array);
+	for (unsigned i = 0; i != params.sq_entries; ++i)
+		sq_array[i] = i;  // Identity mapping, we fill sqes in ring order
+	cq_head = reinterpret_cast<unsigned *>(base + params.cq_off.head);
+	cq_tail = reinterpret_cast<unsigned *>(base + params.cq_off.tail);
+	cq_mask = *reinterpret_cast<unsigned *>(base + params.cq_off.ring_mask);
+	cqes    = reinterpret_cast<io_uring_cqe *>(base + params.cq_off.cqes);
+}
+
+CRAB_INLINE URing::~URing() {
+	if (sqes_ptr != MAP_FAILED)
+		munmap(sqes_ptr, sqes_size);
+	if (sq_ptr != MAP_FAILED)
+		munmap(sq_ptr, sq_size);
+	// closing ring_fd cancels all polls and releases all files they hold
+}
+
+CRAB_INLINE io_uring_sqe *URing::get_sqe() {
+	unsigned tail = *sq_tail;  // Only we modify tail
+	if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) > sq_mask) {
+		submit_and_wait(steady_clock::duration(-1));  // Submission queue full, submit without waiting
+		tail = *sq_tail;
+	}
+	io_uring_sqe *sqe = &sqes[tail & sq_mask];
+	std::memset(sqe, 0, sizeof(io_uring_sqe));
+	// We do not use SQPOLL, kernel reads entries only inside io_uring_enter, so caller can fill sqe after tail moved
+	__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+	return sqe;
+}
+
+CRAB_INLINE int URing::submit_and_wait(steady_clock::duration timeout) {
+	const unsigned to_submit = *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+	const auto ns            = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+	__kernel_timespec ts{ns / 1000000000, ns % 1000000000};
+	io_uring_getevents_arg arg{};
+	arg.ts          = reinterpret_cast<uint64_t>(&ts);
+	unsigned flags  = IORING_ENTER_EXT_ARG;
+	unsigned min_ce = 0;
+	if (timeout.count() >= 0) {
+		flags |= IORING_ENTER_GETEVENTS;
+		min_ce = timeout.count() == 0 ? 0 : 1;
+	}
+	int result = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd.get_value(), to_submit, min_ce, flags, &arg, sizeof(arg)));
+	if (result < 0) {
+		// ETIME is normal timeout, EBUSY is returned when completion queue overflowed, we will reap then repeat
+		check(errno == EINTR || errno == ETIME || errno == EBUSY || errno == EAGAIN, "crab::RunLoop io_uring_enter unexpected error");
+	}
+	return result;
+}
+
+CRAB_INLINE bool URing::peek_cqe(io_uring_cqe *cqe) {
+	unsigned head = *cq_head;  // Only we modify head
+	if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+		return false;
+	*cqe = cqes[head & cq_mask];
+	__atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+CRAB_INLINE uint64_t URing::add_registration(Callable *callable, int fd, uint32_t events) {
+	uint32_t slot = 0;
+	if (free_slots.empty()) {
+		slot = static_cast<uint32_t>(registrations.size());
+		registrations.emplace_back();
+	} else {
+		slot = free_slots.back();
+		free_slots.pop_back();
+	}
+	auto &reg    = registrations[slot];
+	reg.callable = callable;
+	reg.fd       = fd;
+	reg.events   = events;
+	reg.generation += 1;  // never 0, so user_data is never 0
+	const uint64_t user_data = (uint64_t(reg.generation) << 32U) | slot;
+	submit_poll_add(user_data);
+	return user_data;
+}
+
+CRAB_INLINE Callable *URing::find_registration(uint64_t user_data) const {
+	const auto slot = static_cast<uint32_t>(user_data);
+	if (slot >= registrations.size() || registrations[slot].generation != static_cast<uint32_t>(user_data >> 32U))
+		return nullptr;
+	return registrations[slot].callable;
+}
+
+CRAB_INLINE void URing::remove_registration(uint64_t user_data) {
+	const auto slot = static_cast<uint32_t>(user_data);
+	if (find_registration(user_data) == nullptr)
+		return;
+	auto &reg    = registrations[slot];
+	reg.callable = nullptr;
+	reg.fd       = -1;
+	reg.generation += 1;
+	free_slots.push_back(slot);
+	io_uring_sqe *sqe = get_sqe();
+	sqe->opcode       = IORING_OP_POLL_REMOVE;
+	sqe->fd           = -1;
+	sqe->addr         = user_data;
+	sqe->user_data    = REMOVE_USER_DATA;
+}
+
+CRAB_INLINE void URing::submit_poll_add(uint64_t user_data) {
+	const auto &reg    = registrations[static_cast<uint32_t>(user_data)];
+	io_uring_sqe *sqe  = get_sqe();
+	sqe->opcode        = IORING_OP_POLL_ADD;
+	sqe->fd            = reg.fd;
+	sqe->poll32_events = reg.events;  // Little-endian only, kernel swaps halfwords on big-endian
+	sqe->len           = IORING_POLL_ADD_MULTI;
+	sqe->user_data     = user_data;
+}
+
+}  // namespace details
+
+CRAB_INLINE Callable::~Callable() {
+	if (uring_user_data == 0)
+		return;
+	// Owners (UDPTransmitter, UDPReceiver, Signal) declare fd after Callable, so it is already closed, but poll
+	// keeps file alive (UDP port bound) until removal is submitted, so we submit now instead of on next step
+	if (auto loop = RunLoop::current())
+		loop->impl_remove_callable_fd(this, true);
+}
+
+CRAB_INLINE RunLoop::RunLoop()
+    : uring(new details::URing()), wake_fd(eventfd(0, EFD_NONBLOCK)), wake_callable([this]() {
+	    eventfd_t value = 0;
+	    eventfd_read(wake_fd.get_value(), &value);
+	    // TODO - check error
+
+	    links.trigger_cross_thread_calls();
+    }) {
+	if (CurrentLoop::instance)
+		throw std::runtime_error{"RunLoop::RunLoop Only single RunLoop per thread is allowed"};
+	details::check(wake_fd.is_valid(), "crab::RunLoop eventfd failed");
+	impl_add_callable_fd(wake_fd.get_value(), &wake_callable, true, false);
+	CurrentLoop::instance = this;
+}
+
+CRAB_INLINE RunLoop::~RunLoop() {
+	deadline_queues.clear();
+	zerocopy_lingers.reset();
+	wake_callable.uring_user_data = 0;  // Ring is closed below, and all polls are cancelled together
+	uring.reset();
+	CurrentLoop::instance = nullptr;
+}
+
+CRAB_INLINE void RunLoop::impl_add_callable_fd(int fd, Callable *callable, bool read, bool write) {
+	impl_remove_callable_fd(callable);  // Previous registration of reused Callable, if any
+	const uint32_t events     = (read ? uint32_t(EPOLLIN | EPOLLRDHUP) : 0U) | (write ? uint32_t(EPOLLOUT) : 0U);
+	callable->uring_user_data = uring->add_registration(callable, fd, events);
+}
+
+CRAB_INLINE void RunLoop::impl_remove_callable_fd(Callable *callable, bool submit_now) {
+	if (callable->uring_user_data == 0)
+		return;
+	if (uring) {
+		uring->remove_registration(callable->uring_user_data);
+		if (submit_now)
+			uring->submit_and_wait(steady_clock::duration(-1));
+	}
+	callable->uring_user_data = 0;
+}
+
+CRAB_INLINE void RunLoop::step(steady_clock::duration timeout) {
+	if (!precise_timers)
+		timeout = std::chrono::milliseconds(timeout_ms(timeout));
+	uring->submit_and_wait(timeout);  // single syscall for all pending registrations, removals and waiting
+	io_uring_cqe cqe{};
+	int n = 0;
+	while (uring->peek_cqe(&cqe)) {
+		if (cqe.user_data == details::URing::REMOVE_USER_DATA)
+			continue;
+		Callable *impl = uring->find_registration(cqe.user_data);
+		if (!impl)
+			continue;  // Completion for already removed registration
+		n += 1;
+		const auto read_events = EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP;
+		stats.push_record("  event", uring->ring_fd.get_value(), cqe.res);
+		if (cqe.res < 0) {
+			// Poll failed, we report all events, so that read/write will discover error and close socket
+			impl->add_pending_callable(true, true);
+		} else {
+			impl->add_pending_callable(cqe.res & read_events, cqe.res & EPOLLOUT);
+		}
+		if ((cqe.flags & IORING_CQE_F_MORE) == 0 && (cqe.res >= 0 || cqe.res == -ECANCELED)) {
+			// Multishot poll was terminated by kernel (for example on internal overflow), we must rearm it.
+			// Other errors are delivered once, rearming would fail again immediately, spinning the loop
+			uring->submit_poll_add(cqe.user_data);
+		}
+	}
+	stats.push_record("io_uring_enter", uring->ring_fd.get_value(), n);
+	stats.EPOLL_count += 1;
+	stats.EPOLL_size += n;
+	stats.EVENTS_PER_POLL.record(static_cast<uint64_t>(n));
+}
+
+CRAB_INLINE void RunLoop::wakeup() {
+	// Returns error on counter overflow, as we reset counter to 0 on every read, error is extremely unlikely
+	details::check(eventfd_write(wake_fd.get_value(), 1) >= 0, "crab::RunLoop wake_fd counter overflow");
+}
+
+#endif
+
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+
+CRAB_INLINE void RunLoop::impl_linger_zerocopy(details::FileDescriptor &fd, std::unique_ptr<details::ZeroCopyState> &&state) {
+	if (state->pending.empty())
+		return;
+#if CRAB_IMPL_EPOLL
+	// fd stays open, so registration would outlive its Callable, io_uring poll is already removed by caller
+	epoll_ctl(efd.get_value(), EPOLL_CTL_DEL, fd.get_value(), nullptr);
+#endif
+	if (!zerocopy_lingers)
+		zerocopy_lingers.reset(new details::ZeroCopyLingerList{});
+	zerocopy_lingers->add(fd, std::move(state));
+}
+
 CRAB_INLINE Signal::Signal(Handler &&cb, std::vector<int> ss)
-    : a_handler([&, cb]() {  // cb = std::move(cb) is C++14, we will keep C++11 compatibility for some time
+    : a_handler([this]() {
 	    signalfd_siginfo info{};
 	    while (true) {
 		    // Several signals can be merged, we read all of them
@@ -317,8 +864,9 @@ CRAB_INLINE Signal::Signal(Handler &&cb, std::vector<int> ss)
 			    break;
 		    // Condition (bytes >= sizeof(info) && info.ssi_pid == 0) is true if called from terminal
 	    }
-	    cb();
+	    s_handler();
     })
+    , s_handler(std::move(cb))
     , signals(std::move(ss)) {
 	if (signals.empty()) {
 		signals.push_back(SIGINT);
@@ -362,6 +910,21 @@ CRAB_INLINE bool Signal::running_under_debugger() {
 
 #endif
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+
+CRAB_INLINE bool RunLoopGroup::pin_current_thread(int cpu) {
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;  // Mac OS X has only affinity hints via thread_policy_set, which are not pinning
+#endif
+}
+
+#endif
+
 #if CRAB_IMPL_LIBEV
 CRAB_INLINE TCPSocket::TCPSocket(Handler &&cb)
     : rwd_handler(std::move(cb))
@@ -386,6 +949,16 @@ CRAB_INLINE void TCPSocket::close(bool with_event) {
 	closed_event.cancel();
 #endif
 	rwd_handler.cancel_callable();
+#if CRAB_IMPL_URING
+	RunLoop::current()->impl_remove_callable_fd(&rwd_handler);
+#endif
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	if (zerocopy) {
+		// Kernel can still send unsent data after close, so loop keeps socket until it is done with pages
+		RunLoop::current()->impl_linger_zerocopy(fd, std::move(zerocopy));
+		zerocopy.reset();
+	}
+#endif
 	fd.reset();
 	if (with_event) {
 #if CRAB_IMPL_LIBEV
@@ -438,6 +1011,8 @@ CRAB_INLINE bool TCPSocket::connect(const Address &address, const Settings &sett
 			details::setsockopt_int(tmp.get_value(), SOL_SOCKET, SO_SNDBUF, integer_cast<int>(settings.sndbuf_size));
 		if (settings.rcvbuf_size)
 			details::setsockopt_int(tmp.get_value(), SOL_SOCKET, SO_RCVBUF, integer_cast<int>(settings.rcvbuf_size));
+		if (settings.rx_timestamps)
+			details::set_rx_timestamps(tmp.get_value());
 		details::set_nonblocking(tmp.get_value());
 		int connect_result = ::connect(tmp.get_value(), address.impl_get_sockaddr(), address.impl_get_sockaddr_length());
 		if (connect_result < 0 && errno != EINPROGRESS)
@@ -470,7 +1045,23 @@ CRAB_INLINE void TCPSocket::accept(TCPAcceptor &acceptor, Address *accepted_addr
 	if (accepted_addr)
 		*accepted_addr = acceptor.accepted_addr;
 	acceptor.accepted_addr = Address();
-	fd.swap(acceptor.accepted_fd);
+	accept_fd(acceptor.accepted_fd);
+}
+
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+CRAB_INLINE void TCPSocket::accept(TCPHandoffReceiver &receiver, Address *accepted_addr) {
+	if (!receiver.accepted_fd.is_valid())
+		throw std::logic_error{"TCPHandoffReceiver::accept error, forgot if(can_accept())?"};
+	close();
+	if (accepted_addr)
+		*accepted_addr = receiver.accepted_addr;
+	receiver.accepted_addr = Address();
+	accept_fd(receiver.accepted_fd);
+}
+#endif
+
+CRAB_INLINE void TCPSocket::accept_fd(details::FileDescriptor &accepted_fd) {
+	fd.swap(accepted_fd);
 #if CRAB_IMPL_LIBEV
 	io_read.start(fd.get_value(), ev::READ);
 	io_write.start(fd.get_value(), ev::WRITE);
@@ -488,6 +1079,10 @@ CRAB_INLINE void TCPSocket::accept(TCPAcceptor &acceptor, Address *accepted_addr
 }
 
 CRAB_INLINE size_t TCPSocket::read_some(uint8_t *data, size_t count) {
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	if (zerocopy && !zerocopy->pending.empty())  // Completions come as EPOLLERR, which also triggers reading
+		read_zerocopy_completions();
+#endif
 	if (!fd.is_valid() || !rwd_handler.can_read)
 		return 0;
 	RunLoop::current()->stats.RECV_count += 1;
@@ -515,28 +1110,49 @@ CRAB_INLINE size_t TCPSocket::read_some(uint8_t *data, size_t count) {
 }
 
 CRAB_INLINE size_t TCPSocket::read_some(uint8_t *val, size_t count, uint8_t *val2, size_t count2) {
+	const MutableSlice slices[2] = {{val, count}, {val2, count2}};
+	return read_some(slices, 2);
+}
+
+CRAB_INLINE size_t TCPSocket::read_some(const MutableSlice *slices, size_t count) { return read_slices(slices, count, nullptr); }
+
+CRAB_INLINE size_t TCPSocket::read_some(uint8_t *val, size_t count, std::chrono::system_clock::time_point *timestamp) {
+	const MutableSlice slice{val, count};
+	return read_slices(&slice, 1, timestamp);
+}
+
+CRAB_INLINE size_t TCPSocket::read_slices(const MutableSlice *slices, size_t count, std::chrono::system_clock::time_point *timestamp) {
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+	if (zerocopy && !zerocopy->pending.empty())  // Completions come as EPOLLERR, which also triggers reading
+		read_zerocopy_completions();
+#endif
 	if (!fd.is_valid() || !rwd_handler.can_read)
 		return 0;
-	RunLoop::current()->stats.RECV_count += 1;
-	RunLoop::current()->stats.push_record("recv", fd.get_value(), int(count));
-	struct iovec iovec[2];
+	struct iovec iovec[MAX_SLICES];  // Uninitialized
 	auto iovec_count = 0;
-	if (count) {
-		iovec[iovec_count].iov_base = val;
-		iovec[iovec_count].iov_len  = count;
+	size_t total     = 0;
+	for (size_t i = 0; i != count && iovec_count != MAX_SLICES; ++i) {
+		if (slices[i].size == 0)
+			continue;
+		iovec[iovec_count].iov_base = slices[i].data;
+		iovec[iovec_count].iov_len  = slices[i].size;
+		total += slices[i].size;
 		iovec_count += 1;
 	}
-	if (count2) {
-		iovec[iovec_count].iov_base = val2;
-		iovec[iovec_count].iov_len  = count2;
-		iovec_count += 1;
-	}
-	// TODO - decide what happens when iovec_count is 0
+	if (iovec_count == 0)
+		return 0;  // recvmsg would return 0, which means remote closed
+	RunLoop::current()->stats.RECV_count += 1;
+	RunLoop::current()->stats.push_record("recvV", fd.get_value(), int(total));
+	uint8_t control[details::RECV_CONTROL_SIZE];  // Uninitialized
 	struct msghdr msg {};
 	msg.msg_iov    = iovec;
 	msg.msg_iovlen = iovec_count;
+	if (timestamp) {
+		msg.msg_control    = control;
+		msg.msg_controllen = sizeof(control);
+	}
 	ssize_t result = ::recvmsg(fd.get_value(), &msg, details::CRAB_MSG_NOSIGNAL);
-	RunLoop::current()->stats.push_record("R(recv)", fd.get_value(), int(result));
+	RunLoop::current()->stats.push_record("R(recvV)", fd.get_value(), int(result));
 	if (result == 0) {  // remote closed
 		close(true);
 		return 0;
@@ -552,6 +1168,11 @@ CRAB_INLINE size_t TCPSocket::read_some(uint8_t *val, size_t count, uint8_t *val
 #endif
 		return 0;  // Will fire on_epoll_call in future automatically
 	}
+	if (timestamp) {
+		const auto tp = details::get_rx_timestamp(msg);
+		if (tp != std::chrono::system_clock::time_point{})
+			*timestamp = tp;
+	}
 	RunLoop::current()->stats.RECV_size += result;
 	return result;
 }
@@ -578,6 +1199,39 @@ CRAB_INLINE size_t TCPSocket::write_some(const uint8_t *data, size_t count) {
 	return result;
 }
 
+CRAB_INLINE size_t TCPSocket::write_some(const ConstSlice *slices, size_t count) {
+	if (!fd.is_valid() || !rwd_handler.can_write || count == 0)
+		return 0;
+	struct iovec iovec[MAX_SLICES];  // Uninitialized
+	auto iovec_count = std::min<size_t>(count, MAX_SLICES);
+	size_t total     = 0;
+	for (size_t i = 0; i != iovec_count; ++i) {
+		iovec[i].iov_base = const_cast<uint8_t *>(slices[i].data);  // sendmsg promises not to modify data
+		iovec[i].iov_len  = slices[i].size;
+		total += slices[i].size;
+	}
+	struct msghdr msg {};
+	msg.msg_iov    = iovec;
+	msg.msg_iovlen = iovec_count;
+	RunLoop::current()->stats.SEND_count += 1;
+	RunLoop::current()->stats.push_record("sendV", fd.get_value(), int(total));
+	ssize_t result = ::sendmsg(fd.get_value(), &msg, details::CRAB_MSG_NOSIGNAL);
+	RunLoop::current()->stats.push_record("R(sendV)", fd.get_value(), int(result));
+	if (result < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {  // some REAL error
+			close(true);
+			return 0;
+		}
+		rwd_handler.can_write = false;
+#if CRAB_IMPL_LIBEV
+		io_write.start(fd.get_value(), ev::WRITE);
+#endif
+		return 0;  // Will fire on_epoll_call in future automatically
+	}
+	RunLoop::current()->stats.SEND_size += result;
+	return result;
+}
+
 CRAB_INLINE size_t TCPSocket::write_some(std::deque<Buffer> &data) {
 	if (!fd.is_valid() || !rwd_handler.can_write || data.empty())
 		return 0;
@@ -625,6 +1279,158 @@ CRAB_INLINE size_t TCPSocket::write_some(std::deque<Buffer> &data) {
 	return result;
 }
 
+CRAB_INLINE size_t TCPSocket::write_file(int file_fd, uint64_t offset, size_t count) {
+	if (!fd.is_valid() || !rwd_handler.can_write || count == 0)
+		return 0;
+	RunLoop::current()->stats.SEND_count += 1;
+	RunLoop::current()->stats.push_record("sendfile", fd.get_value(), int(count));
+#if defined(__linux__)
+	// sendfile has no MSG_NOSIGNAL, so unless SIGPIPE is ignored (cheapest), it is blocked for the duration of call,
+	// consumed if raised, then signal mask of the thread is restored
+	struct sigaction action {};
+	const bool guard = ::sigaction(SIGPIPE, nullptr, &action) != 0 || action.sa_handler != SIG_IGN;
+	sigset_t sigpipe_set;
+	sigset_t old_set;
+	sigemptyset(&sigpipe_set);
+	sigaddset(&sigpipe_set, SIGPIPE);
+	if (guard)
+		pthread_sigmask(SIG_BLOCK, &sigpipe_set, &old_set);
+	off_t off      = static_cast<off_t>(offset);
+	ssize_t result = ::sendfile(fd.get_value(), file_fd, &off, count);
+	if (guard) {
+		const int err = errno;
+		if (result < 0 && err == EPIPE && !sigismember(&old_set, SIGPIPE)) {  // If was blocked, pending one is not ours
+			const struct timespec zero {};
+			sigtimedwait(&sigpipe_set, nullptr, &zero);
+		}
+		pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+		errno = err;
+	}
+#elif defined(__MACH__)
+	off_t len      = static_cast<off_t>(count);
+	ssize_t result = ::sendfile(file_fd, fd.get_value(), static_cast<off_t>(offset), &len, nullptr, 0);
+	if (result == 0 || ((errno == EAGAIN || errno == EWOULDBLOCK) && len != 0))
+		result = len;  // Returns 0 with bytes sent in len, partial send is reported as EAGAIN, we will get EAGAIN again
+#else
+	uint8_t buffer[65536];  // Uninitialized, no portable sendfile, so we copy
+	ssize_t result = ::pread(file_fd, buffer, std::min(count, sizeof(buffer)), static_cast<off_t>(offset));
+	if (result > 0)
+		result = ::send(fd.get_value(), buffer, result, details::CRAB_MSG_NOSIGNAL);
+#endif
+	RunLoop::current()->stats.push_record("R(sendfile)", fd.get_value(), int(result));
+	if (result < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {  // some REAL error
+			close(true);
+			return 0;
+		}
+		rwd_handler.can_write = false;
+#if CRAB_IMPL_LIBEV
+		io_write.start(fd.get_value(), ev::WRITE);
+#endif
+		return 0;  // Will fire on_epoll_call in future automatically
+	}
+	RunLoop::current()->stats.SEND_size += result;
+	return result;
+}
+
+#if CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+CRAB_INLINE size_t TCPSocket::write_zerocopy(const uint8_t *data, size_t count, std::shared_ptr<const void> holder) {
+	if (!fd.is_valid() || !rwd_handler.can_write || count == 0)
+		return 0;
+	if (!zerocopy) {
+		zerocopy.reset(new details::ZeroCopyState{});
+		const int value     = 1;
+		zerocopy->supported = setsockopt(fd.get_value(), SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value)) >= 0;
+	}
+	if (!zerocopy->supported)
+		return write_some(data, count);
+	RunLoop::current()->stats.SEND_count += 1;
+	RunLoop::current()->stats.push_record("sendZ", fd.get_value(), int(count));
+	ssize_t result = ::send(fd.get_value(), data, count, details::CRAB_MSG_NOSIGNAL | MSG_ZEROCOPY);
+	RunLoop::current()->stats.push_record("R(sendZ)", fd.get_value(), int(result));
+	if (result < 0) {
+		if (errno == ENOBUFS)  // Limit of pinned pages or notification memory reached, kernel wants us to copy
+			return write_some(data, count);
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {  // some REAL error
+			close(true);
+			return 0;
+		}
+		rwd_handler.can_write = false;
+		return 0;  // Will fire on_epoll_call in future automatically
+	}
+	RunLoop::current()->stats.SEND_size += result;
+	zerocopy->pending.emplace_back(zerocopy->next_id++, std::move(holder));
+	return result;
+}
+
+CRAB_INLINE void TCPSocket::read_zerocopy_completions() {
+	if (fd.is_valid() && zerocopy)
+		details::read_zerocopy_completions(fd.get_value(), *zerocopy);
+}
+
+CRAB_INLINE void details::read_zerocopy_completions(int fd, ZeroCopyState &state) {
+	auto &pending = state.pending;
+	while (!pending.empty()) {
+		uint8_t control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_storage))];  // Uninitialized
+		struct msghdr msg {};
+		msg.msg_control    = control;
+		msg.msg_controllen = sizeof(control);
+		if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+			return;  // EAGAIN, error queue is empty
+		for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+			const bool ip_err = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+			                    (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+			if (!ip_err)
+				continue;
+			sock_extended_err err{};
+			std::memcpy(&err, CMSG_DATA(cm), sizeof(err));
+			if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+			// Notification covers range of send ids [ee_info..ee_data], ids wrap around
+			const uint32_t width = err.ee_data - err.ee_info;
+			auto in_range        = [&](const std::pair<uint32_t, std::shared_ptr<const void>> &p) { return p.first - err.ee_info <= width; };
+			if (!in_range(pending.front())) {  // Ids are increasing, so ranges usually come in order, but can be reordered
+				pending.erase(std::remove_if(pending.begin(), pending.end(), in_range), pending.end());
+				continue;
+			}
+			while (!pending.empty() && in_range(pending.front()))
+				pending.pop_front();
+		}
+	}
+}
+
+CRAB_INLINE details::ZeroCopyLingerList::~ZeroCopyLingerList() {
+	for (auto &linger : sockets) {
+		read_zerocopy_completions(linger.fd.get_value(), *linger.state);
+		if (!linger.state->pending.empty())
+			linger.state.release();  // Leak is better than letting NIC read freed memory
+	}
+}
+
+CRAB_INLINE void details::ZeroCopyLingerList::add(FileDescriptor &fd, std::unique_ptr<ZeroCopyState> &&state) {
+	read_zerocopy_completions(fd.get_value(), *state);
+	if (state->pending.empty())
+		return;
+	// Like close(), peer gets FIN after queued data, but socket stays, so that kernel can report completions
+	::shutdown(fd.get_value(), SHUT_RDWR);
+	const int user_timeout = USER_TIMEOUT_MS;  // Errors ignored, connection can be already reset
+	::setsockopt(fd.get_value(), IPPROTO_TCP, TCP_USER_TIMEOUT, &user_timeout, sizeof(user_timeout));
+	sockets.emplace_back();
+	auto it = std::prev(sockets.end());
+	it->fd.swap(fd);
+	it->state           = std::move(state);
+	it->handler.handler = [this, it]() { on_error_queue(it); };
+	// Neither read nor write, error queue readiness (EPOLLERR) is always reported
+	RunLoop::current()->impl_add_callable_fd(it->fd.get_value(), &it->handler, false, false);
+}
+
+CRAB_INLINE void details::ZeroCopyLingerList::on_error_queue(std::list<Linger>::iterator it) {
+	read_zerocopy_completions(it->fd.get_value(), *it->state);
+	if (it->state->pending.empty())
+		sockets.erase(it);  // Kernel is done with pages, both holders and socket can go
+}
+#endif
+
 CRAB_INLINE Address TCPSocket::local_address() const {
 	Address in_addr;
 	socklen_t in_len = sizeof(sockaddr_storage);
@@ -672,6 +1478,8 @@ CRAB_INLINE TCPAcceptor::TCPAcceptor(const Address &address, Handler &&cb, const
 		details::setsockopt_int(tmp.get_value(), SOL_SOCKET, SO_SNDBUF, integer_cast<int>(settings.sndbuf_size));
 	if (settings.rcvbuf_size)
 		details::setsockopt_int(tmp.get_value(), SOL_SOCKET, SO_RCVBUF, integer_cast<int>(settings.rcvbuf_size));
+	if (settings.rx_timestamps)
+		details::set_rx_timestamps(tmp.get_value());
 
 	if (::bind(tmp.get_value(), address.impl_get_sockaddr(), address.impl_get_sockaddr_length()) < 0) {
 		std::stringstream ss;
@@ -682,6 +1490,11 @@ CRAB_INLINE TCPAcceptor::TCPAcceptor(const Address &address, Handler &&cb, const
 	details::set_nonblocking(tmp.get_value());
 	// Specifying 0 as a second param leads to RST to client on some systems when lots of clients rush in.
 	details::check(listen(tmp.get_value(), SOMAXCONN) >= 0, "crab::TCPAcceptor listen failed");
+#if defined(__linux__)
+	// Must be after socket joined reuse port group, otherwise program creates separate group and bind fails
+	if (settings.reuse_port && !settings.reuse_port_cpus.empty())
+		details::attach_reuseport_cpus(tmp.get_value(), settings.reuse_port_cpus);
+#endif
 #if CRAB_IMPL_LIBEV
 	io_read.start(tmp.get_value(), ev::READ);
 #else
@@ -690,7 +1503,33 @@ CRAB_INLINE TCPAcceptor::TCPAcceptor(const Address &address, Handler &&cb, const
 	fd.swap(tmp);
 }
 
-CRAB_INLINE TCPAcceptor::~TCPAcceptor() = default;
+CRAB_INLINE TCPAcceptor::TCPAcceptor(int listening_fd, Handler &&cb)
+    : a_handler(std::move(cb))
+    , fd(listening_fd)
+    , fd_limit_timer([&]() { a_handler.handler(); })
+#if CRAB_IMPL_LIBEV
+    , io_read(RunLoop::current()->get_impl()) {
+	io_read.set<TCPAcceptor, &TCPAcceptor::io_cb_read>(this);
+#else
+{
+#endif
+	details::check(fd.is_valid(), "crab::TCPAcceptor invalid listening fd");
+	details::set_nonblocking(fd.get_value());
+#if CRAB_IMPL_LIBEV
+	io_read.start(fd.get_value(), ev::READ);
+#else
+	RunLoop::current()->impl_add_callable_fd(fd.get_value(), &a_handler, true, false);
+#endif
+}
+
+CRAB_INLINE TCPAcceptor::~TCPAcceptor() {
+#if CRAB_IMPL_URING
+	// a_handler is destroyed after fd, but poll keeps listening socket alive, so that rebinding port
+	// fails and reuseport group steers connections into it. We must remove poll before close.
+	if (auto loop = RunLoop::current())
+		loop->impl_remove_callable_fd(&a_handler, true);
+#endif
+}
 
 CRAB_INLINE bool TCPAcceptor::can_accept() {
 	if (accepted_fd.is_valid())
@@ -751,6 +1590,80 @@ CRAB_INLINE bool TCPAcceptor::can_accept() {
 	}
 }
 
+#if CRAB_IMPL_KEVENT || CRAB_IMPL_EPOLL || CRAB_IMPL_URING
+CRAB_INLINE TCPHandoffReceiver::TCPHandoffReceiver(Handler &&cb) : watcher(std::move(cb)), ring(CAPACITY) {}
+
+CRAB_INLINE TCPHandoffReceiver::~TCPHandoffReceiver() {
+	details::HandoffSocket socket;
+	while (ring.pop(socket))
+		details::FileDescriptor close_fd(socket.fd);
+}
+
+CRAB_INLINE bool TCPHandoffReceiver::can_accept() {
+	if (accepted_fd.is_valid())
+		return true;
+	details::HandoffSocket socket;
+	if (!ring.pop(socket))
+		return false;
+	accepted_fd.reset(socket.fd);
+	accepted_addr = socket.address;
+	return true;
+}
+
+CRAB_INLINE bool TCPHandoffReceiver::push(details::HandoffSocket &socket) {
+	connections.fetch_add(1, std::memory_order_relaxed);  // Before push, so that connection_closed() never goes below 0
+	if (!ring.push(socket)) {
+		connections.fetch_sub(1, std::memory_order_relaxed);
+		return false;
+	}
+	watcher.call();
+	return true;
+}
+
+CRAB_INLINE TCPHandoff::TCPHandoff(TCPAcceptor &acceptor, std::vector<TCPHandoffReceiver *> receivers, Policy policy)
+    : acceptor(acceptor), receivers(std::move(receivers)), policy(policy), retry_timer([&]() { on_accept(); }) {
+	if (this->receivers.empty())
+		throw std::logic_error{"TCPHandoff needs at least one receiver"};
+	acceptor.set_handler([&]() { on_accept(); });
+	on_accept();  // Connections could be accepted before we set handler
+}
+
+CRAB_INLINE TCPHandoffReceiver *TCPHandoff::select_receiver(size_t attempt) {
+	if (policy == ROUND_ROBIN)
+		return receivers[(next_receiver + attempt) % receivers.size()];
+	// Least connections, on retries we try receivers in round-robin order, so that full one is skipped
+	if (attempt != 0)
+		return receivers[(next_receiver + attempt) % receivers.size()];
+	size_t best = 0;
+	for (size_t i = 1; i != receivers.size(); ++i)
+		if (receivers[i]->get_connections() < receivers[best]->get_connections())
+			best = i;
+	next_receiver = best;
+	return receivers[best];
+}
+
+CRAB_INLINE void TCPHandoff::on_accept() {
+	while (acceptor.can_accept()) {
+		details::HandoffSocket socket;
+		socket.fd      = acceptor.accepted_fd.get_value();
+		socket.address = acceptor.accepted_addr;
+		size_t attempt = 0;
+		for (; attempt != receivers.size(); ++attempt)
+			if (select_receiver(attempt)->push(socket))
+				break;
+		if (attempt == receivers.size()) {
+			// All workers are overloaded, connection stays in acceptor, new ones wait in backlog
+			retry_timer.once(0.01);
+			return;
+		}
+		acceptor.accepted_fd.release();  // Now owned by receiver
+		acceptor.accepted_addr = Address();
+		next_receiver          = (next_receiver + attempt + 1) % receivers.size();
+		handoff_count += 1;
+	}
+}
+#endif
+
 CRAB_INLINE bool UDPTransmitter::can_write() const { return rw_handler.can_write; }
 
 CRAB_INLINE void UDPTransmitter::set_multicast_ttl(int ttl) {
@@ -767,6 +1680,9 @@ CRAB_INLINE void UDPTransmitter::io_cb_write(ev::io &, int) {
 #endif
 
 CRAB_INLINE UDPTransmitter::UDPTransmitter(const Address &address, Handler &&cb, const std::string &adapter)
+    : UDPTransmitter(address, std::move(cb), details::udp_settings_with_adapter(adapter)) {}
+
+CRAB_INLINE UDPTransmitter::UDPTransmitter(const Address &address, Handler &&cb, const Settings &settings)
     : rw_handler(std::move(cb))
 #if CRAB_IMPL_LIBEV
     , io_write(RunLoop::current()->get_impl()) {
@@ -777,10 +1693,21 @@ CRAB_INLINE UDPTransmitter::UDPTransmitter(const Address &address, Handler &&cb,
 	details::FileDescriptor tmp(
 	    ::socket(address.impl_get_sockaddr()->sa_family, SOCK_DGRAM, IPPROTO_UDP), "crab::UDPTransmitter socket() failed");
 	details::set_nonblocking(tmp.get_value());
+	if (settings.sndbuf_size)
+		details::setsockopt_int(tmp.get_value(), SOL_SOCKET, SO_SNDBUF, integer_cast<int>(settings.sndbuf_size));
+	if (settings.rcvbuf_size)
+		details::setsockopt_int(tmp.get_value(), SOL_SOCKET, SO_RCVBUF, integer_cast<int>(settings.rcvbuf_size));
+	if (settings.rx_timestamps)
+		details::set_rx_timestamps(tmp.get_value());
+#if defined(__linux__)
+	udp_gso = settings.udp_gso;  // UDP_SEGMENT is set per sendmsg, so we learn if it is supported on first send
+	if (settings.tx_timestamps)
+		details::set_tx_timestamps(tmp.get_value());
+#endif
 
 	if (address.is_multicast()) {
 		details::setsockopt_int(tmp.get_value(), SOL_SOCKET, SO_BROADCAST, 1);
-		auto mreq = details::fill_ip_mreqn(adapter);
+		auto mreq = details::fill_ip_mreqn(settings.adapter);
 		details::check(setsockopt(tmp.get_value(), IPPROTO_IP, IP_MULTICAST_IF, &mreq, sizeof(mreq)) >= 0,
 		    "crab::UDPTransmitter: Failed to select multicast adapter");
 		// On multiadapter system, we should select adapter to send multicast to,
@@ -807,8 +1734,80 @@ CRAB_INLINE bool UDPTransmitter::write_datagram(const uint8_t *data, size_t coun
 	return details::write_datagram(fd, rw_handler, data, count, nullptr);
 }
 
-CRAB_INLINE optional<size_t> UDPTransmitter::read_datagram(uint8_t *data, size_t count, Address *peer_addr) {
-	return details::read_datagram(fd, rw_handler, data, count, peer_addr);
+CRAB_INLINE size_t UDPTransmitter::write_datagrams(const ConstSlice *datagrams, size_t count) {
+	return details::write_datagrams(fd, rw_handler, datagrams, nullptr, count);
+}
+
+CRAB_INLINE size_t UDPTransmitter::write_segmented(const uint8_t *data, size_t count, size_t segment_size) {
+	invariant(segment_size != 0 && segment_size <= UDPReceiver::MAX_DATAGRAM_SIZE, "UDPTransmitter invalid segment_size");
+	const size_t total = (count + segment_size - 1) / segment_size;
+	size_t sent        = 0;
+#if defined(__linux__)
+	const size_t per_call = std::min<size_t>(MAX_GSO_SEGMENTS, UDPReceiver::MAX_DATAGRAM_SIZE / segment_size);
+	while (udp_gso && sent != total && fd.is_valid() && rw_handler.can_write) {
+		const size_t offset = sent * segment_size;
+		const size_t size   = std::min(count - offset, per_call * segment_size);
+		struct iovec iov {};
+		iov.iov_base = const_cast<uint8_t *>(data + offset);  // sendmsg promises not to modify data
+		iov.iov_len  = size;
+		uint8_t control[CMSG_SPACE(sizeof(uint16_t))]{};
+		struct msghdr msg {};
+		msg.msg_iov             = &iov;
+		msg.msg_iovlen          = 1;
+		msg.msg_control         = control;
+		msg.msg_controllen      = sizeof(control);
+		cmsghdr *cm             = CMSG_FIRSTHDR(&msg);
+		cm->cmsg_level          = SOL_UDP;
+		cm->cmsg_type           = UDP_SEGMENT;
+		cm->cmsg_len            = CMSG_LEN(sizeof(uint16_t));
+		const uint16_t gso_size = static_cast<uint16_t>(segment_size);
+		std::memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+		RunLoop::current()->stats.UDP_SEND_count += 1;
+		RunLoop::current()->stats.push_record("sendGSO", fd.get_value(), int(size));
+		ssize_t result = ::sendmsg(fd.get_value(), &msg, details::CRAB_MSG_NOSIGNAL);
+		RunLoop::current()->stats.push_record("R(sendGSO)", fd.get_value(), int(result));
+		if (result < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				rw_handler.can_write = false;
+				return sent;  // Will fire on_epoll_call in future automatically
+			}
+			if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+				udp_gso = false;  // No GSO in kernel or device, or segment_size above MTU
+				break;
+			}
+			// Other errors are ignored, like in write_datagram
+		} else {
+			RunLoop::current()->stats.UDP_SEND_size += result;
+		}
+		sent += (size + segment_size - 1) / segment_size;
+	}
+#endif
+	while (sent != total) {
+		ConstSlice slices[MAX_DATAGRAMS_BATCH];  // Uninitialized
+		size_t batch = 0;
+		for (; batch != MAX_DATAGRAMS_BATCH && sent + batch != total; ++batch) {
+			const size_t offset = (sent + batch) * segment_size;
+			slices[batch]       = ConstSlice{data + offset, std::min(segment_size, count - offset)};
+		}
+		const size_t wr = details::write_datagrams(fd, rw_handler, slices, nullptr, batch);
+		sent += wr;
+		if (wr != batch)
+			break;
+	}
+	return sent;
+}
+
+CRAB_INLINE optional<size_t> UDPTransmitter::read_datagram(
+    uint8_t *data, size_t count, Address *peer_addr, std::chrono::system_clock::time_point *timestamp) {
+	return details::read_datagram(fd, rw_handler, data, count, peer_addr, timestamp);
+}
+
+CRAB_INLINE bool UDPTransmitter::read_tx_timestamp(TxTimestamp &ts) {
+#if defined(__linux__)
+	return details::read_tx_timestamp(fd, ts);
+#else
+	return false;
+#endif
 }
 
 #if CRAB_IMPL_LIBEV
@@ -840,6 +1839,16 @@ CRAB_INLINE UDPReceiver::UDPReceiver(const Address &address, Handler &&cb, const
 		details::setsockopt_int(tmp.get_value(), SOL_SOCKET, SO_SNDBUF, integer_cast<int>(settings.sndbuf_size));
 	if (settings.rcvbuf_size)
 		details::setsockopt_int(tmp.get_value(), SOL_SOCKET, SO_RCVBUF, integer_cast<int>(settings.rcvbuf_size));
+	rx_timestamps = settings.rx_timestamps;
+	if (rx_timestamps)
+		details::set_rx_timestamps(tmp.get_value());
+#if defined(__linux__)
+	const int gro_value = 1;
+	udp_gro = settings.udp_gro && setsockopt(tmp.get_value(), SOL_UDP, UDP_GRO, &gro_value, sizeof(gro_value)) >= 0;
+	// Old kernels do not support UDP_GRO, then datagrams are never coalesced
+	if (settings.tx_timestamps)
+		details::set_tx_timestamps(tmp.get_value());
+#endif
 
 	if (address.is_multicast()) {
 		// TODO - check flag combination on Mac
@@ -878,22 +1887,114 @@ CRAB_INLINE bool UDPReceiver::write_datagram(const uint8_t *data, size_t count,
 	return details::write_datagram(fd, rw_handler, data, count, &peer_addr);
 }
 
+CRAB_INLINE size_t UDPReceiver::write_datagrams(const ConstSlice *datagrams, const Address *peer_addrs, size_t count) {
+	return details::write_datagrams(fd, rw_handler, datagrams, peer_addrs, count);
+}
+
 CRAB_INLINE bool UDPReceiver::can_write() const { return rw_handler.can_write; }
 
-CRAB_INLINE optional<size_t> UDPReceiver::read_datagram(uint8_t *data, size_t count, Address *peer_addr) {
-	return details::read_datagram(fd, rw_handler, data, count, peer_addr);
+CRAB_INLINE optional<size_t> UDPReceiver::read_datagram(
+    uint8_t *data, size_t count, Address *peer_addr, std::chrono::system_clock::time_point *timestamp) {
+	if (!udp_gro)
+		return details::read_datagram(fd, rw_handler, data, count, peer_addr, timestamp);
+	if (!gro_buffer) {
+		gro_buffer.reset(new DatagramBuffer);  // data left uninitialized
+		gro_next = gro_buffer->datagram_count();
+	}
+	if (gro_next == gro_buffer->datagram_count()) {
+		if (read_datagrams(gro_buffer.get(), 1) == 0)
+			return {};
+		gro_next = 0;
+	}
+	const ConstSlice datagram = gro_buffer->datagram(gro_next++);
+	std::memcpy(data, datagram.data, std::min(count, datagram.size));  // Truncated like in read_datagram
+	if (peer_addr)
+		*peer_addr = gro_buffer->peer_addr;
+	if (timestamp)
+		*timestamp = gro_buffer->timestamp;
+	return datagram.size;
+}
+
+CRAB_INLINE bool UDPReceiver::read_tx_timestamp(TxTimestamp &ts) {
+#if defined(__linux__)
+	return details::read_tx_timestamp(fd, ts);
+#else
+	return false;
+#endif
 }
 
 CRAB_INLINE size_t UDPReceiver::read_datagrams(DatagramBuffer *buffer, size_t buffer_len) {
-	// TODO - optimize with readmmsg
 	if (buffer_len == 0)
 		return 0;
-	auto result = details::read_datagram(fd, rw_handler, buffer->data, MAX_DATAGRAM_SIZE, &buffer->peer_addr);
-	if (!result) {
+	if (gro_buffer && gro_next != gro_buffer->datagram_count() && buffer != gro_buffer.get()) {
+		const ConstSlice rest = gro_buffer->datagram(gro_next);  // Rest is consecutive, last may be shorter
+		buffer->count         = gro_buffer->count - (rest.data - gro_buffer->data);
+		buffer->segment_size  = gro_next + 1 == gro_buffer->datagram_count() ? 0 : gro_buffer->segment_size;
+		buffer->peer_addr     = gro_buffer->peer_addr;
+		buffer->timestamp     = gro_buffer->timestamp;
+		std::memcpy(buffer->data, rest.data, buffer->count);
+		gro_next = gro_buffer->datagram_count();
+		return 1;
+	}
+#if defined(__linux__)
+	if (!fd.is_valid() || !rw_handler.can_read)
+		return 0;
+	struct mmsghdr msgs[MAX_DATAGRAMS_BATCH];  // Uninitialized
+	struct iovec iovecs[MAX_DATAGRAMS_BATCH];  // Uninitialized
+	uint8_t controls[MAX_DATAGRAMS_BATCH][details::RECV_CONTROL_SIZE];  // Uninitialized
+	const size_t batch = std::min<size_t>(buffer_len, MAX_DATAGRAMS_BATCH);
+	for (size_t i = 0; i != batch; ++i) {
+		iovecs[i].iov_base          = buffer[i].data;
+		iovecs[i].iov_len           = MAX_DATAGRAM_SIZE;
+		msgs[i].msg_hdr             = msghdr{};
+		msgs[i].msg_hdr.msg_iov     = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen  = 1;
+		msgs[i].msg_hdr.msg_name    = buffer[i].peer_addr.impl_get_sockaddr();
+		msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+		msgs[i].msg_len             = 0;
+		if (udp_gro || rx_timestamps) {
+			msgs[i].msg_hdr.msg_control    = controls[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+		}
+	}
+	RunLoop::current()->stats.UDP_RECV_count += 1;
+	RunLoop::current()->stats.push_record("recvmmsg", fd.get_value(), int(batch));
+	const int result = ::recvmmsg(fd.get_value(), msgs, static_cast<unsigned>(batch), details::CRAB_MSG_NOSIGNAL, nullptr);
+	RunLoop::current()->stats.push_record("R(recvmmsg)", fd.get_value(), result);
+	if (result < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			rw_handler.can_read = false;  // Will fire on_epoll_call in future automatically
+		// Other errors are ignored, like in read_datagram
 		return 0;
 	}
-	buffer->count = *result;
-	return 1;
+	for (int i = 0; i != result; ++i) {
+		buffer[i].count        = msgs[i].msg_len;  // Truncated datagrams are returned, like in read_datagram
+		buffer[i].segment_size = 0;
+		buffer[i].timestamp    = rx_timestamps ? details::get_rx_timestamp(msgs[i].msg_hdr) : std::chrono::system_clock::time_point{};
+		RunLoop::current()->stats.UDP_RECV_size += msgs[i].msg_len;
+		if (!udp_gro)
+			continue;
+		for (cmsghdr *cm = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cm; cm = CMSG_NXTHDR(&msgs[i].msg_hdr, cm))
+			if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+				int gso_size = 0;
+				std::memcpy(&gso_size, CMSG_DATA(cm), sizeof(gso_size));
+				if (gso_size > 0 && size_t(gso_size) < buffer[i].count)
+					buffer[i].segment_size = gso_size;
+			}
+	}
+	return static_cast<size_t>(result);
+#else
+	size_t count = 0;
+	for (; count != buffer_len; ++count) {
+		auto result = details::read_datagram(
+		    fd, rw_handler, buffer[count].data, MAX_DATAGRAM_SIZE, &buffer[count].peer_addr, &buffer[count].timestamp);
+		if (!result)
+			break;
+		buffer[count].count        = *result;
+		buffer[count].segment_size = 0;
+	}
+	return count;
+#endif
 }
 
 }  // namespace crab
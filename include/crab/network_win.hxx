@@ -94,13 +94,14 @@ struct RunLoopImpl {
 	~RunLoopImpl() { WSACleanup(); }
 };
 
-CRAB_INLINE RunLoop::RunLoop() : impl(new RunLoopImpl([this]() { links.trigger_called_watchers(); })) {
+CRAB_INLINE RunLoop::RunLoop() : impl(new RunLoopImpl([this]() { links.trigger_cross_thread_calls(); })) {
 	if (CurrentLoop::instance)
 		throw std::runtime_error{"RunLoop::RunLoop Only single RunLoop per thread is allowed"};
 	CurrentLoop::instance = this;
 }
 
 CRAB_INLINE RunLoop::~RunLoop() {
+	deadline_queues.clear();
 	while (impl->pending_counter != 0) {  // This cleanup cannot be in ~Impl because there would be no current_loop then
 		std::cout << "RunLoop::~Impl() stepping through pending_counter=" << impl->pending_counter << std::endl;
 		step();
@@ -110,7 +111,8 @@ CRAB_INLINE RunLoop::~RunLoop() {
 	CurrentLoop::instance = nullptr;
 }
 
-CRAB_INLINE void RunLoop::step(int timeout_ms) {
+CRAB_INLINE void RunLoop::step(steady_clock::duration timeout) {
+	const DWORD timeout_ms = static_cast<DWORD>(RunLoop::timeout_ms(timeout));  // Precise timers are not supported
 	if (details::MAX_EVENTS <= 1) {
 		OVERLAPPED *ovl         = nullptr;
 		DWORD transferred       = 0;
@@ -141,6 +143,7 @@ CRAB_INLINE void RunLoop::step(int timeout_ms) {
 	stats.push_record("GetQueuedCompletionStatusEx", 0, n);
 	stats.EPOLL_count += 1;
 	stats.EPOLL_size += n;
+	stats.EVENTS_PER_POLL.record(static_cast<uint64_t>(n));
 	for (int i = 0; i != n; ++i) {
 		if (events[i].lpCompletionKey != details::OverlappedKey)
 			continue;
@@ -160,6 +163,12 @@ CRAB_INLINE void RunLoop::cancel() {
 	wakeup();
 }
 
+CRAB_INLINE bool RunLoopGroup::pin_current_thread(int cpu) {
+	if (cpu < 0 || cpu >= int(sizeof(DWORD_PTR) * 8))
+		return false;
+	return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+}
+
 CRAB_INLINE bool SignalStop::running_under_debugger() { return false; }
 
 CRAB_INLINE Signal::Signal(Handler &&cb, const std::vector<int> &) : a_handler(std::move(cb)) {}
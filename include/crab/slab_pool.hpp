@@ -0,0 +1,66 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "util.hpp"
+
+namespace crab {
+
+// Allocator of I/O buffer storage (Buffer, Rope chunks) in power of 2 size classes from 4 KB to 1 MB. Pool is
+// thread-local, so each RunLoop has its own and no locks are taken. Chunks are carved from 2 MB slabs, which
+// are never returned to system, optionally backed by huge pages. Chunk can be freed on other thread, when free
+// list of a class grows above limit, half of it goes to shared depot, from which pools refill before mapping
+// new slabs. Larger requests are served by operator new and counted, so that stats show if serving allocates.
+class SlabPool : private Nocopy {
+public:
+	enum {
+		MIN_CHUNK_SIZE = 4096,
+		MAX_CHUNK_SIZE = 1024 * 1024,
+		SIZE_CLASSES   = 9,  // 4 KB .. 1 MB
+		SLAB_SIZE      = 2 * 1024 * 1024,
+		MAX_FREE_BYTES = 4 * SLAB_SIZE  // per class, above that half of free list goes to depot
+	};
+
+	struct Stats {
+		size_t ALLOC_count     = 0;  // chunks taken from pool
+		size_t FREE_count      = 0;  // chunks returned to pool
+		size_t SLAB_count      = 0;  // slabs taken from system
+		size_t SLAB_HUGE_count = 0;  // of them backed by explicit huge pages (MAP_HUGETLB)
+		size_t DEPOT_count     = 0;  // refills from shared depot
+		size_t HEAP_count      = 0;  // allocations larger than MAX_CHUNK_SIZE, served by operator new
+	};
+
+	static SlabPool &current();  // of calling thread, must not be used during thread exit, see below
+
+	static uint8_t *thread_allocate(size_t size);
+	static void thread_deallocate(uint8_t *ptr, size_t size);
+	// Like current().allocate/deallocate, but also work after pool of calling thread is destroyed (static Buffer
+	// or Rope destroyed after thread_local pool of main thread), by going to shared depot under lock
+
+	static void set_huge_pages(bool enable);
+	// Process-wide, affects slabs mapped after call. Linux only, tries MAP_HUGETLB (needs pages reserved in
+	// /proc/sys/vm/nr_hugepages), then falls back to madvise(MADV_HUGEPAGE)
+
+	uint8_t *allocate(size_t size);               // never nullptr, size 0 is treated as 1
+	void deallocate(uint8_t *ptr, size_t size);  // size must be the same as in allocate()
+
+	static size_t chunk_size(size_t size);  // actual size of chunk allocated for size, 0 if operator new is used
+	const Stats &get_stats() const { return stats; }
+
+	SlabPool() = default;
+	~SlabPool();  // gives free chunks to depot, so they are reused after thread exits, marks thread as exiting
+
+private:
+	std::vector<uint8_t *> free_lists[SIZE_CLASSES];
+	Stats stats;
+
+	static size_t size_class(size_t size);
+	void refill(size_t cls);
+	static uint8_t *map_slab(bool &huge);
+};
+
+}  // namespace crab
@@ -0,0 +1,175 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include "slab_pool.hpp"
+
+#if defined(__linux__) || defined(__MACH__)
+#include <sys/mman.h>
+#endif
+
+namespace crab {
+
+namespace details {
+
+struct SlabDepot {
+	std::mutex mutex;
+	std::vector<uint8_t *> free_lists[SlabPool::SIZE_CLASSES];
+	std::atomic<bool> huge_pages{false};
+
+	static SlabDepot &get_instance() {
+		static SlabDepot *instance = new SlabDepot{};  // Never destroyed, pools of exiting threads use it
+		return *instance;
+	}
+	static bool &pool_destroyed() {  // trivially destructible, so can be read after thread_local pool is destroyed
+		static thread_local bool destroyed = false;
+		return destroyed;
+	}
+};
+
+}  // namespace details
+
+CRAB_INLINE SlabPool &SlabPool::current() {
+	static thread_local SlabPool instance;
+	return instance;
+}
+
+CRAB_INLINE uint8_t *SlabPool::thread_allocate(size_t size) {
+	if (!details::SlabDepot::pool_destroyed())
+		return current().allocate(size);
+	const size_t cls = size_class(size);
+	if (cls >= SIZE_CLASSES)
+		return static_cast<uint8_t *>(::operator new(size));
+	auto &depot = details::SlabDepot::get_instance();
+	std::unique_lock<std::mutex> lock(depot.mutex);
+	auto &depot_list = depot.free_lists[cls];
+	if (depot_list.empty()) {  // Rest of new slab goes to depot, so that following calls take from it
+		bool huge          = false;
+		uint8_t *slab      = map_slab(huge);
+		const size_t count = SLAB_SIZE / (size_t(MIN_CHUNK_SIZE) << cls);
+		for (size_t i = count; i-- > 0;)
+			depot_list.push_back(slab + i * (size_t(MIN_CHUNK_SIZE) << cls));
+	}
+	uint8_t *result = depot_list.back();
+	depot_list.pop_back();
+	return result;
+}
+
+CRAB_INLINE void SlabPool::thread_deallocate(uint8_t *ptr, size_t size) {
+	if (!details::SlabDepot::pool_destroyed())
+		return current().deallocate(ptr, size);
+	const size_t cls = size_class(size);
+	if (cls >= SIZE_CLASSES)
+		return ::operator delete(ptr);
+	auto &depot = details::SlabDepot::get_instance();
+	std::unique_lock<std::mutex> lock(depot.mutex);
+	depot.free_lists[cls].push_back(ptr);
+}
+
+CRAB_INLINE void SlabPool::set_huge_pages(bool enable) { details::SlabDepot::get_instance().huge_pages = enable; }
+
+CRAB_INLINE size_t SlabPool::size_class(size_t size) {
+	size_t cls = 0;
+	while ((size_t(MIN_CHUNK_SIZE) << cls) < size)
+		cls += 1;
+	return cls;  // SIZE_CLASSES if too large
+}
+
+CRAB_INLINE size_t SlabPool::chunk_size(size_t size) {
+	const size_t cls = size_class(size);
+	return cls < SIZE_CLASSES ? size_t(MIN_CHUNK_SIZE) << cls : 0;
+}
+
+CRAB_INLINE uint8_t *SlabPool::allocate(size_t size) {
+	const size_t cls = size_class(size);
+	if (cls >= SIZE_CLASSES) {
+		stats.HEAP_count += 1;
+		return static_cast<uint8_t *>(::operator new(size));
+	}
+	auto &free_list = free_lists[cls];
+	if (free_list.empty())
+		refill(cls);
+	stats.ALLOC_count += 1;
+	uint8_t *result = free_list.back();
+	free_list.pop_back();
+	return result;
+}
+
+CRAB_INLINE void SlabPool::deallocate(uint8_t *ptr, size_t size) {
+	const size_t cls = size_class(size);
+	if (cls >= SIZE_CLASSES)
+		return ::operator delete(ptr);
+	stats.FREE_count += 1;
+	auto &free_list = free_lists[cls];
+	free_list.push_back(ptr);
+	if (free_list.size() * (size_t(MIN_CHUNK_SIZE) << cls) <= MAX_FREE_BYTES)
+		return;
+	// Chunks allocated on other threads accumulate here, give half to depot
+	auto &depot = details::SlabDepot::get_instance();
+	std::unique_lock<std::mutex> lock(depot.mutex);
+	const size_t half = free_list.size() / 2;
+	depot.free_lists[cls].insert(depot.free_lists[cls].end(), free_list.end() - half, free_list.end());
+	free_list.resize(free_list.size() - half);
+}
+
+CRAB_INLINE void SlabPool::refill(size_t cls) {
+	auto &free_list       = free_lists[cls];
+	const size_t per_slab = SLAB_SIZE / (size_t(MIN_CHUNK_SIZE) << cls);
+	{
+		auto &depot = details::SlabDepot::get_instance();
+		std::unique_lock<std::mutex> lock(depot.mutex);
+		auto &depot_list = depot.free_lists[cls];
+		if (!depot_list.empty()) {
+			const size_t count = std::min(per_slab, depot_list.size());
+			free_list.insert(free_list.end(), depot_list.end() - count, depot_list.end());
+			depot_list.resize(depot_list.size() - count);
+			stats.DEPOT_count += 1;
+			return;
+		}
+	}
+	bool huge     = false;
+	uint8_t *slab = map_slab(huge);
+	stats.SLAB_count += 1;
+	stats.SLAB_HUGE_count += huge ? 1 : 0;
+	for (size_t i = per_slab; i-- > 0;)  // So that chunks are taken in address order
+		free_list.push_back(slab + i * (size_t(MIN_CHUNK_SIZE) << cls));
+}
+
+CRAB_INLINE uint8_t *SlabPool::map_slab(bool &huge) {
+#if defined(__linux__) || defined(__MACH__)
+	const bool want_huge = details::SlabDepot::get_instance().huge_pages;
+#if defined(__linux__)
+	if (want_huge) {
+		void *result = mmap(nullptr, SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (result != MAP_FAILED) {
+			huge = true;
+			return static_cast<uint8_t *>(result);
+		}
+	}
+#endif
+	void *result = mmap(nullptr, SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (result == MAP_FAILED)
+		throw std::bad_alloc();
+#if defined(__linux__)
+	if (want_huge)
+		madvise(result, SLAB_SIZE, MADV_HUGEPAGE);  // Transparent huge pages, if enabled, ignore errors
+#endif
+	return static_cast<uint8_t *>(result);
+#else
+	return static_cast<uint8_t *>(::operator new(SLAB_SIZE));
+#endif
+}
+
+CRAB_INLINE SlabPool::~SlabPool() {
+	// Other thread_local or static objects can free storage later, on main thread statics are destroyed after us
+	details::SlabDepot::pool_destroyed() = true;
+	auto &depot = details::SlabDepot::get_instance();
+	std::unique_lock<std::mutex> lock(depot.mutex);
+	for (size_t cls = 0; cls != SIZE_CLASSES; ++cls)
+		depot.free_lists[cls].insert(depot.free_lists[cls].end(), free_lists[cls].begin(), free_lists[cls].end());
+}
+
+}  // namespace crab
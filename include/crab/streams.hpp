@@ -10,16 +10,30 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "slab_pool.hpp"
 #include "util.hpp"
 
 namespace crab {
 
+// Parts of data for vectored I/O, aggregates
+struct ConstSlice {
+	const uint8_t *data;
+	size_t size;
+};
+struct MutableSlice {
+	uint8_t *data;
+	size_t size;
+};
+
 class IStream {
 public:
 	virtual ~IStream()                                   = default;
 	virtual size_t read_some(uint8_t *val, size_t count) = 0;
 	void read(uint8_t *val, size_t count);
 
+	virtual size_t read_some(const MutableSlice *slices, size_t count);
+	// fills slices in order, returns total bytes read. Sockets read all slices in single syscall
+
 	// We do not wish to use void* due to unsafe conversions, we wish all 3 common byte types
 	size_t read_some(char *val, size_t count) { return read_some(uint8_cast(val), count); }
 	void read(char *val, size_t count) { read(uint8_cast(val), count); }
@@ -36,6 +50,9 @@ public:
 	void write(const uint8_t *val, size_t count);
 	void write_byte(uint8_t val) { write(&val, 1); }  // name prevents dangerous conversions
 
+	virtual size_t write_some(const ConstSlice *slices, size_t count);
+	// writes slices in order, returns total bytes written. Sockets write all slices in single syscall
+
 	// We do not wish to use void* due to unsafe conversions, we wish all 3 common byte types
 	size_t write_some(const char *val, size_t count) { return write_some(uint8_cast(val), count); }
 	void write(const char *val, size_t count) { write(uint8_cast(val), count); }
@@ -55,14 +72,33 @@ public:
 	size_t write_to(OStream &out) { return write_to(out, std::numeric_limits<size_t>::max()); }
 };
 
-// Classic circular buffer
+// Classic circular buffer. Storage is taken from SlabPool on first write and returned on clear() and destruction,
+// so closed connections do not hold buffer memory and connection churn does not allocate
 class Buffer final : public IFiniteStream, public OStream {
-	bdata impl;
-	size_t read_pos;   // 0..impl.size-1
-	size_t write_pos;  // read_pos..read_pos + impl.size
+	uint8_t *storage = nullptr;
+	size_t si;         // capacity, storage is SlabPool chunk of at least that size
+	size_t read_pos;   // 0..si-1
+	size_t write_pos;  // read_pos..read_pos + si
+	uint8_t *data() {
+		if (!storage && si != 0)
+			storage = SlabPool::thread_allocate(si);
+		return storage;
+	}
+	void release() {
+		if (storage)
+			SlabPool::thread_deallocate(storage, si);
+		storage = nullptr;
+	}
+
 public:
-	explicit Buffer(size_t si) : impl(si), read_pos(0), write_pos(0) {}
-	size_t capacity() const { return impl.size(); }
+	explicit Buffer(size_t si) : si(si), read_pos(0), write_pos(0) {}
+	Buffer(const Buffer &other);
+	Buffer(Buffer &&other) noexcept;
+	Buffer &operator=(const Buffer &other);
+	Buffer &operator=(Buffer &&other) noexcept;
+	~Buffer() override { release(); }
+
+	size_t capacity() const { return si; }
 	size_t read_some(uint8_t *val, size_t count) override;
 	using IStream::read_some;  // Version for other char types
 	size_t size() const override {
@@ -71,22 +107,25 @@ public:
 	size_t write_some(const uint8_t *val, size_t count) override;
 	using OStream::write_some;  // Version for other char types
 
-	void clear() { read_pos = write_pos = 0; }
+	void clear() {  // also returns storage to pool
+		read_pos = write_pos = 0;
+		release();
+	}
 	void clear(size_t new_size) {
 		clear();
-		impl.resize(new_size);
+		si = new_size;
 	}
 
-	bool full() const { return read_pos + impl.size() == write_pos; }
+	bool full() const { return read_pos + si == write_pos; }
 
-	size_t read_count() const { return write_pos < impl.size() ? write_pos - read_pos : impl.size() - read_pos; }
-	const uint8_t *read_ptr() const { return impl.data() + read_pos; }
-	size_t write_count() const { return write_pos < impl.size() ? impl.size() - write_pos : read_pos - (write_pos - impl.size()); }
-	uint8_t *write_ptr() { return write_pos < impl.size() ? impl.data() + write_pos : impl.data() + write_pos - impl.size(); }
+	size_t read_count() const { return write_pos < si ? write_pos - read_pos : si - read_pos; }
+	const uint8_t *read_ptr() const { return storage + read_pos; }
+	size_t write_count() const { return write_pos < si ? si - write_pos : read_pos - (write_pos - si); }
+	uint8_t *write_ptr() { return write_pos < si ? data() + write_pos : data() + write_pos - si; }
 
 	void did_write(size_t count) {
 		write_pos += count;
-		invariant(write_pos <= read_pos + impl.size(), "Writing past end of Buffer");
+		invariant(write_pos <= read_pos + si, "Writing past end of Buffer");
 	}
 	void did_write_undo(size_t count) {
 		invariant(write_pos >= read_pos + count, "Writing undo past read_pos");
@@ -95,19 +134,19 @@ public:
 	void did_read(size_t count) {
 		read_pos += count;
 		invariant(read_pos <= write_pos, "Reading past end of Buffer");
-		if (read_pos >= impl.size()) {  // could did read from 2 parts of circular buffer
-			read_pos -= impl.size();
-			write_pos -= impl.size();
+		if (read_pos >= si) {  // could did read from 2 parts of circular buffer
+			read_pos -= si;
+			write_pos -= si;
 		}
 		if (read_pos == write_pos)
 			read_pos = write_pos = 0;  // Increases chance of single-chunk reading
 	}
 
 	// circular buffer has maximum 2 parts. this gives second part
-	size_t read_count2() const { return write_pos < impl.size() ? 0 : write_pos - impl.size(); }
-	const uint8_t *read_ptr2() const { return impl.data(); }
-	size_t write_count2() const { return write_pos < impl.size() ? read_pos : 0; }
-	uint8_t *write_ptr2() { return impl.data(); }
+	size_t read_count2() const { return write_pos < si ? 0 : write_pos - si; }
+	const uint8_t *read_ptr2() const { return storage; }
+	size_t write_count2() const { return write_pos < si ? read_pos : 0; }
+	uint8_t *write_ptr2() { return data(); }
 
 	size_t read_from(IStream &in);                             // returns # read
 	size_t write_to(OStream &out, size_t max_count) override;  // returns # written
@@ -117,30 +156,49 @@ public:
 	bool peek(uint8_t *val, size_t count) const;
 };
 
-/*class Rope : public IFiniteStream, public OStream {
-    std::deque<Buffer> rope;
-    size_t chunk_size;
-    size_t rope_size = 0;
+// Growable stream of fixed-size chunks, so growing never reallocates or moves data already written. Chunks are
+// taken from and returned to SlabPool, steady-state buffering does not allocate.
+// read_from and write_to transfer several chunks per vectored read_some/write_some.
+class Rope final : public IFiniteStream, public OStream {
 public:
-    explicit Rope(size_t chunk_size);
-    size_t read_some(uint8_t *val, size_t count) override;
-    size_t size() const override { return rope_size; }
-    size_t write_some(const uint8_t *val, size_t count) override;
+	enum { CHUNK_SIZE = 16384, READ_CHUNKS = 4, WRITE_CHUNKS = 64 };
 
-    void clear();
+	Rope() = default;
+	Rope(Rope &&other) noexcept;
+	Rope &operator=(Rope &&other) noexcept;
+	~Rope() override { clear(); }
 
-    size_t read_count() const { return rope.front().read_count(); }
-    const uint8_t *read_ptr() { return rope.front().read_ptr(); }
-    size_t write_count() const { return rope.back().write_count(); }
-    uint8_t *write_ptr() { return rope.back().write_ptr(); }
+	size_t read_some(uint8_t *val, size_t count) override;
+	using IStream::read_some;  // Version for other char types
+	size_t size() const override { return rope_size; }
+	size_t write_some(const uint8_t *val, size_t count) override;  // always writes all data
+	using OStream::write_some;                                      // Version for other char types
+
+	void clear();  // returns chunks to pool
 
-    void did_write(size_t count);
-    void did_read(size_t count);
+	// Contiguous part at front, 0 if empty
+	size_t read_count() const;
+	const uint8_t *read_ptr() const { return chunks.front() + read_pos; }
+	void did_read(size_t count);  // can be more than read_count(), up to size()
 
-    size_t read_from(IStream &in);                             // returns # read
-    size_t write_to(OStream &out, size_t max_count) override;  // returns # written
-    using IFiniteStream::write_to;
-};*/
+	// Contiguous free space at back, adds chunk if there is none, so never 0
+	size_t write_count();
+	uint8_t *write_ptr() { return chunks.back() + write_pos; }
+	void did_write(size_t count);  // up to write_count()
+
+	size_t read_from(IStream &in);  // returns # read, reads until in returns less than asked
+	size_t write_to(OStream &out, size_t max_count) override;  // returns # written
+	using IFiniteStream::write_to;
+
+private:
+	std::deque<uint8_t *> chunks;  // data is from front()[read_pos] to back()[write_pos]
+	size_t read_pos  = 0;
+	size_t write_pos = 0;
+	size_t rope_size = 0;
+
+	static uint8_t *allocate_chunk() { return SlabPool::thread_allocate(CHUNK_SIZE); }
+	static void free_chunk(uint8_t *chunk) { SlabPool::thread_deallocate(chunk, CHUNK_SIZE); }
+};
 
 class IMemoryStream : public IFiniteStream {
 protected:
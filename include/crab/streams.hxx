@@ -30,6 +30,63 @@ CRAB_INLINE void OStream::write(const uint8_t *val, size_t count) {
 	}
 }
 
+CRAB_INLINE size_t IStream::read_some(const MutableSlice *slices, size_t count) {
+	size_t total_count = 0;
+	for (size_t i = 0; i != count; ++i) {
+		const size_t rc = read_some(slices[i].data, slices[i].size);
+		total_count += rc;
+		if (rc != slices[i].size)
+			break;
+	}
+	return total_count;
+}
+
+CRAB_INLINE size_t OStream::write_some(const ConstSlice *slices, size_t count) {
+	size_t total_count = 0;
+	for (size_t i = 0; i != count; ++i) {
+		const size_t wc = write_some(slices[i].data, slices[i].size);
+		total_count += wc;
+		if (wc != slices[i].size)
+			break;
+	}
+	return total_count;
+}
+
+CRAB_INLINE Buffer::Buffer(const Buffer &other) : si(other.si), read_pos(other.read_pos), write_pos(other.write_pos) {
+	if (other.storage)
+		std::memcpy(data(), other.storage, si);
+}
+
+CRAB_INLINE Buffer::Buffer(Buffer &&other) noexcept
+    : storage(other.storage), si(other.si), read_pos(other.read_pos), write_pos(other.write_pos) {
+	other.storage  = nullptr;
+	other.read_pos = other.write_pos = 0;
+}
+
+CRAB_INLINE Buffer &Buffer::operator=(const Buffer &other) {
+	if (this != &other) {
+		clear(other.si);
+		read_pos  = other.read_pos;
+		write_pos = other.write_pos;
+		if (other.storage)
+			std::memcpy(data(), other.storage, si);
+	}
+	return *this;
+}
+
+CRAB_INLINE Buffer &Buffer::operator=(Buffer &&other) noexcept {
+	if (this != &other) {
+		release();
+		storage        = other.storage;
+		si             = other.si;
+		read_pos       = other.read_pos;
+		write_pos      = other.write_pos;
+		other.storage  = nullptr;
+		other.read_pos = other.write_pos = 0;
+	}
+	return *this;
+}
+
 CRAB_INLINE size_t Buffer::read_some(uint8_t *val, size_t count) {
 	size_t rc = std::min(count, read_count());
 	std::memcpy(val, read_ptr(), rc);
@@ -97,72 +154,139 @@ CRAB_INLINE bool Buffer::peek(uint8_t *val, size_t count) const {
 	return true;
 }
 
-/*
-// Invariant - at least 1 chunk in rope container to avoid ifs
-Rope::Rope(size_t chunk_size) : chunk_size(chunk_size) {
-    rope.emplace_back(chunk_size);
-}
-
-void Rope::clear() {
-    if (rope.size() >= 1) {
-        Buffer buf = std::move(rope.front());
-        rope.clear();
-        rope.push_back(std::move(buf));
-    } else {
-        rope.clear();
-        rope.emplace_back(chunk_size);
-    }
-    rope_size = 0;
-}
-
-void Rope::did_write(size_t count) {
-    rope_size += count;
-    rope.back().did_write(count);
-    if (rope.back().full())
-        rope.emplace_back(chunk_size);
-}
-
-void Rope::did_read(size_t count) {
-    invariant(count <= rope_size, "Rope underflow");
-    rope_size -= count;
-    rope.front().did_read(count);
-    if (rope.front().empty()) {
-        rope.pop_front();
-        if (rope.empty())
-            rope.emplace_back(chunk_size);
-    }
-}
-
-size_t Rope::read_from(IStream &in) {
-    size_t total_count = 0;
-    while (true) {
-        size_t wc = write_count();
-        if (wc == 0)
-            break;
-        size_t count = in.read_some(write_ptr(), wc);
-        did_write(count);
-        total_count += count;
-        if (count == 0)
-            break;
-    }
-    return total_count;
-}
-
-size_t Rope::write_to(OStream &out, size_t max_count) {
-    size_t total_count = 0;
-    while (true) {
-        size_t rc = std::min(read_count(), max_count);
-        if (rc == 0)
-            break;
-        size_t count = out.write_some(read_ptr(), rc);
-        did_read(count);
-        max_count -= count;
-        total_count += count;
-        if (count == 0)
-            break;
-    }
-    return total_count;
-}*/
+CRAB_INLINE Rope::Rope(Rope &&other) noexcept
+    : chunks(std::move(other.chunks)), read_pos(other.read_pos), write_pos(other.write_pos), rope_size(other.rope_size) {
+	other.chunks.clear();
+	other.read_pos = other.write_pos = other.rope_size = 0;
+}
+
+CRAB_INLINE Rope &Rope::operator=(Rope &&other) noexcept {
+	if (this != &other) {
+		clear();
+		chunks.swap(other.chunks);
+		std::swap(read_pos, other.read_pos);
+		std::swap(write_pos, other.write_pos);
+		std::swap(rope_size, other.rope_size);
+	}
+	return *this;
+}
+
+CRAB_INLINE void Rope::clear() {
+	for (auto chunk : chunks)
+		free_chunk(chunk);
+	chunks.clear();
+	read_pos = write_pos = rope_size = 0;
+}
+
+CRAB_INLINE size_t Rope::read_count() const {
+	if (rope_size == 0)
+		return 0;
+	return chunks.size() == 1 ? write_pos - read_pos : CHUNK_SIZE - read_pos;
+}
+
+CRAB_INLINE void Rope::did_read(size_t count) {
+	invariant(count <= rope_size, "Reading past end of Rope");
+	rope_size -= count;
+	if (rope_size == 0)
+		return clear();  // Also returns last chunk, so idle connections do not hold memory
+	read_pos += count;
+	while (read_pos >= CHUNK_SIZE) {
+		free_chunk(chunks.front());
+		chunks.pop_front();
+		read_pos -= CHUNK_SIZE;
+	}
+}
+
+CRAB_INLINE size_t Rope::write_count() {
+	if (chunks.empty() || write_pos == CHUNK_SIZE) {
+		chunks.push_back(allocate_chunk());
+		write_pos = 0;
+	}
+	return CHUNK_SIZE - write_pos;
+}
+
+CRAB_INLINE void Rope::did_write(size_t count) {
+	invariant(!chunks.empty() && write_pos + count <= CHUNK_SIZE, "Writing past end of Rope chunk");
+	write_pos += count;
+	rope_size += count;
+}
+
+CRAB_INLINE size_t Rope::read_some(uint8_t *val, size_t count) {
+	size_t total_count = 0;
+	while (total_count != count) {
+		const size_t rc = std::min(count - total_count, read_count());
+		if (rc == 0)
+			break;
+		std::memcpy(val + total_count, read_ptr(), rc);
+		did_read(rc);
+		total_count += rc;
+	}
+	return total_count;
+}
+
+CRAB_INLINE size_t Rope::write_some(const uint8_t *val, size_t count) {
+	size_t total_count = 0;
+	while (total_count != count) {
+		const size_t wc = std::min(count - total_count, write_count());
+		std::memcpy(write_ptr(), val + total_count, wc);
+		did_write(wc);
+		total_count += wc;
+	}
+	return total_count;
+}
+
+CRAB_INLINE size_t Rope::read_from(IStream &in) {
+	size_t total_count = 0;
+	while (true) {
+		MutableSlice slices[READ_CHUNKS];         // Uninitialized
+		const size_t first_room = write_count();  // Adds chunk if back one is full
+		const size_t first_new  = chunks.size();
+		slices[0]               = MutableSlice{write_ptr(), first_room};
+		for (size_t i = 1; i != READ_CHUNKS; ++i) {
+			chunks.push_back(allocate_chunk());
+			slices[i] = MutableSlice{chunks.back(), CHUNK_SIZE};
+		}
+		const size_t count = in.read_some(slices, READ_CHUNKS);
+		// Keep chunks which received data, return others
+		const size_t rest     = count > first_room ? count - first_room : 0;
+		const size_t used_new = (rest + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		while (chunks.size() > first_new + used_new) {
+			free_chunk(chunks.back());
+			chunks.pop_back();
+		}
+		write_pos = used_new == 0 ? write_pos + count : rest - (used_new - 1) * CHUNK_SIZE;
+		rope_size += count;
+		total_count += count;
+		if (count != first_room + (READ_CHUNKS - 1) * CHUNK_SIZE)
+			break;
+	}
+	if (rope_size == 0)
+		clear();  // Nothing was read into empty rope
+	return total_count;
+}
+
+CRAB_INLINE size_t Rope::write_to(OStream &out, size_t max_count) {
+	size_t total_count = 0;
+	while (max_count != 0 && rope_size != 0) {
+		ConstSlice slices[WRITE_CHUNKS];  // Uninitialized
+		size_t slices_count = 0;
+		size_t count        = 0;
+		for (size_t i = 0; i != chunks.size() && slices_count != WRITE_CHUNKS && count != max_count; ++i) {
+			const size_t from = i == 0 ? read_pos : 0;
+			const size_t to   = i + 1 == chunks.size() ? write_pos : size_t(CHUNK_SIZE);
+			const size_t wc   = std::min(to - from, max_count - count);
+			slices[slices_count++] = ConstSlice{chunks[i] + from, wc};
+			count += wc;
+		}
+		const size_t wr = out.write_some(slices, slices_count);
+		did_read(wr);
+		max_count -= wr;
+		total_count += wr;
+		if (wr != count)
+			break;
+	}
+	return total_count;
+}
 
 /*void Buffer::write(const uint8_t *val, size_t count) {
     size_t rc = std::min(count, write_count());
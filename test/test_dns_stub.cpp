@@ -0,0 +1,199 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <crab/crab.hpp>
+
+using crab::DNSStubResolver;
+
+void put_u16(std::vector<uint8_t> &data, uint16_t value) {
+	data.push_back(static_cast<uint8_t>(value >> 8));
+	data.push_back(static_cast<uint8_t>(value));
+}
+
+void put_name(std::vector<uint8_t> &data, const std::string &name) {  // uncompressed, name must be valid
+	size_t start = 0;
+	while (start < name.size()) {
+		size_t end = name.find('.', start);
+		if (end == std::string::npos)
+			end = name.size();
+		data.push_back(static_cast<uint8_t>(end - start));
+		data.insert(data.end(), name.begin() + start, name.begin() + end);
+		start = end + 1;
+	}
+	data.push_back(0);
+}
+
+void put_pointer(std::vector<uint8_t> &data, size_t offset) { put_u16(data, static_cast<uint16_t>(0xC000 | offset)); }
+
+// Record with owner name already put by caller
+void put_record(std::vector<uint8_t> &data, uint16_t type, const std::vector<uint8_t> &rdata) {
+	put_u16(data, type);
+	put_u16(data, 1);  // IN
+	put_u16(data, 0);  // TTL
+	put_u16(data, 300);
+	put_u16(data, static_cast<uint16_t>(rdata.size()));
+	data.insert(data.end(), rdata.begin(), rdata.end());
+}
+
+// Response header from query, with question copied
+std::vector<uint8_t> make_response(const std::vector<uint8_t> &query, uint16_t ancount, int rcode = 0) {
+	std::vector<uint8_t> response = query;
+	response[2]                   = 0x81;  // QR, RD
+	response[3]                   = static_cast<uint8_t>(0x80 | rcode);  // RA
+	response[6]                   = static_cast<uint8_t>(ancount >> 8);
+	response[7]                   = static_cast<uint8_t>(ancount);
+	return response;
+}
+
+bool parse(const std::vector<uint8_t> &response, const std::vector<uint8_t> &query, std::vector<crab::Address> &names, int &rcode) {
+	names.clear();
+	rcode = 100;
+	return DNSStubResolver::parse_response(response.data(), response.size(), query, 80, names, rcode);
+}
+
+void test_build_query() {
+	std::vector<uint8_t> query;
+	invariant(DNSStubResolver::build_query(query, 0x1234, "www.example.com", DNSStubResolver::TYPE_A), "");
+	const uint8_t expected[] = {0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0, 3, 'w', 'w', 'w', 7, 'e', 'x', 'a', 'm', 'p', 'l',
+	    'e', 3, 'c', 'o', 'm', 0, 0, 1, 0, 1};
+	invariant(query == std::vector<uint8_t>(expected, expected + sizeof(expected)), "wrong query");
+	std::vector<uint8_t> query2;
+	invariant(DNSStubResolver::build_query(query2, 0x1234, "www.example.com.", DNSStubResolver::TYPE_A), "");
+	invariant(query == query2, "trailing dot must be allowed");
+	invariant(!DNSStubResolver::build_query(query, 1, "", DNSStubResolver::TYPE_A), "");
+	invariant(!DNSStubResolver::build_query(query, 1, ".", DNSStubResolver::TYPE_A), "");
+	invariant(!DNSStubResolver::build_query(query, 1, "a..b", DNSStubResolver::TYPE_A), "");
+	invariant(!DNSStubResolver::build_query(query, 1, std::string(64, 'a') + ".com", DNSStubResolver::TYPE_A), "");
+	invariant(DNSStubResolver::build_query(query, 1, std::string(63, 'a') + ".com", DNSStubResolver::TYPE_A), "");
+	std::string long_name;
+	for (size_t i = 0; i != 5; ++i)
+		long_name += std::string(60, 'a') + ".";
+	invariant(!DNSStubResolver::build_query(query, 1, long_name, DNSStubResolver::TYPE_A), "name over 255 bytes");
+}
+
+void test_answers() {
+	std::vector<uint8_t> query;
+	DNSStubResolver::build_query(query, 0xBEEF, "www.example.com", DNSStubResolver::TYPE_A);
+	std::vector<crab::Address> names;
+	int rcode = 0;
+	// Two A records, owner names compressed to question
+	auto response = make_response(query, 2);
+	put_pointer(response, 12);
+	put_record(response, DNSStubResolver::TYPE_A, {10, 0, 0, 1});
+	put_pointer(response, 12);
+	put_record(response, DNSStubResolver::TYPE_A, {10, 0, 0, 2});
+	invariant(parse(response, query, names, rcode) && rcode == DNSStubResolver::RCODE_NOERROR, "");
+	invariant(names.size() == 2 && names[0].get_address() == "10.0.0.1" && names[1].get_address() == "10.0.0.2", "");
+	invariant(names[0].get_port() == 80, "port must be set");
+
+	// Truncated in the middle of second record, first is taken
+	auto truncated = response;
+	truncated.resize(truncated.size() - 3);
+	invariant(parse(truncated, query, names, rcode) && names.size() == 1 && names[0].get_address() == "10.0.0.1", "");
+	truncated.resize(query.size() + 1);  // in the middle of owner name pointer
+	invariant(parse(truncated, query, names, rcode) && names.empty(), "");
+
+	// Case of question can be changed by server (0x20 encoding)
+	auto changed_case = response;
+	changed_case[13]  = 'W';
+	invariant(parse(changed_case, query, names, rcode) && names.size() == 2, "");
+}
+
+void test_cname_chain() {
+	std::vector<uint8_t> query;
+	DNSStubResolver::build_query(query, 7, "www.example.com", DNSStubResolver::TYPE_AAAA);
+	auto response = make_response(query, 3);
+	// www.example.com CNAME edge.example.net, edge.example.net CNAME e1.cdn.example.net, e1... AAAA ::1
+	put_pointer(response, 12);
+	std::vector<uint8_t> rdata1;
+	put_name(rdata1, "edge.example.net");
+	put_record(response, 5, rdata1);
+	const size_t edge_offset = response.size() - rdata1.size();
+	put_pointer(response, edge_offset);
+	std::vector<uint8_t> rdata2{2, 'e', '1', 3, 'c', 'd', 'n'};
+	put_pointer(rdata2, edge_offset + 5);  // "example.net" inside first CNAME
+	put_record(response, 5, rdata2);
+	const size_t e1_offset = response.size() - rdata2.size();
+	put_pointer(response, e1_offset);
+	std::vector<uint8_t> address(16, 0);
+	address[15] = 1;
+	put_record(response, DNSStubResolver::TYPE_AAAA, address);
+	// A record for other type must be ignored
+	response[7] = 4;
+	put_pointer(response, e1_offset);
+	put_record(response, DNSStubResolver::TYPE_A, {1, 2, 3, 4});
+
+	std::vector<crab::Address> names;
+	int rcode = 0;
+	invariant(parse(response, query, names, rcode) && rcode == DNSStubResolver::RCODE_NOERROR, "");
+	invariant(names.size() == 1 && names[0].get_address() == "::1" && names[0].get_port() == 80, "CNAME chain broken");
+}
+
+void test_not_ours() {
+	std::vector<uint8_t> query;
+	DNSStubResolver::build_query(query, 0x0102, "example.com", DNSStubResolver::TYPE_A);
+	std::vector<crab::Address> names;
+	int rcode = 0;
+	auto response = make_response(query, 1);
+	put_pointer(response, 12);
+	put_record(response, DNSStubResolver::TYPE_A, {10, 0, 0, 1});
+	invariant(parse(response, query, names, rcode) && names.size() == 1, "");
+
+	auto wrong_id = response;
+	wrong_id[1]   = 0x03;
+	invariant(!parse(wrong_id, query, names, rcode), "mismatched id must be ignored");
+
+	std::vector<uint8_t> other_query;
+	DNSStubResolver::build_query(other_query, 0x0102, "examplf.com", DNSStubResolver::TYPE_A);
+	invariant(!parse(response, other_query, names, rcode), "mismatched question must be ignored");
+
+	std::vector<uint8_t> other_type;
+	DNSStubResolver::build_query(other_type, 0x0102, "example.com", DNSStubResolver::TYPE_AAAA);
+	invariant(!parse(response, other_type, names, rcode), "mismatched question type must be ignored");
+
+	auto not_response = response;
+	not_response[2]   = 0x01;
+	invariant(!parse(not_response, query, names, rcode), "query must not be taken as response");
+
+	auto two_questions = response;
+	two_questions[5]   = 2;
+	invariant(!parse(two_questions, query, names, rcode), "");
+
+	auto short_message = response;
+	short_message.resize(query.size() - 1);
+	invariant(!parse(short_message, query, names, rcode), "");
+}
+
+void test_rcodes() {
+	std::vector<uint8_t> query;
+	DNSStubResolver::build_query(query, 99, "nonexistent.example.com", DNSStubResolver::TYPE_A);
+	std::vector<crab::Address> names;
+	int rcode = 0;
+	auto nxdomain = make_response(query, 0, DNSStubResolver::RCODE_NXDOMAIN);
+	put_name(nxdomain, "example.com");  // SOA in authority section, not counted in ANCOUNT
+	invariant(parse(nxdomain, query, names, rcode) && rcode == DNSStubResolver::RCODE_NXDOMAIN && names.empty(), "");
+
+	auto servfail = make_response(query, 0, 2);
+	invariant(parse(servfail, query, names, rcode) && rcode == 2 && names.empty(), "");
+
+	auto tc = make_response(query, 1);
+	tc[2] |= 0x02;
+	put_pointer(tc, 12);
+	put_record(tc, DNSStubResolver::TYPE_A, {10, 0, 0, 1});
+	invariant(parse(tc, query, names, rcode) && rcode == DNSStubResolver::RCODE_TRUNCATED, "TC must be reported");
+	invariant(names.empty(), "records of truncated response must not be used");
+}
+
+int main() {
+	test_build_query();
+	test_answers();
+	test_cname_chain();
+	test_not_ours();
+	test_rcodes();
+	std::cout << "test_dns_stub passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <crab/crab.hpp>
+
+using Ring = crab::details::MPSCRing<uint64_t>;
+
+void test_single_thread() {
+	const size_t CAPACITY = 8;
+	Ring ring(CAPACITY);
+	uint64_t value = 0;
+	invariant(ring.empty() && !ring.pop(value), "");
+	uint64_t next_push = 0;
+	uint64_t next_pop  = 0;
+	for (size_t round = 0; round != 100; ++round) {  // many wraps of sequence numbers
+		const size_t to_push = 1 + round % CAPACITY;
+		for (size_t i = 0; i != to_push; ++i) {
+			value = next_push;
+			invariant(ring.push(value), "");
+			next_push += 1;
+		}
+		for (size_t i = 0; i != to_push; ++i) {
+			invariant(!ring.empty() && ring.pop(value) && value == next_pop, "wrong order");
+			next_pop += 1;
+		}
+		invariant(ring.empty() && !ring.pop(value), "");
+	}
+	for (size_t i = 0; i != CAPACITY; ++i) {
+		value = i;
+		invariant(ring.push(value), "");
+	}
+	value = 12345;
+	invariant(!ring.push(value) && value == 12345, "push into full ring must fail and keep value");
+	invariant(ring.pop(value) && value == 0, "");
+	value = CAPACITY;
+	invariant(ring.push(value), "freed cell must be reused");
+	for (size_t i = 1; i != CAPACITY + 1; ++i)
+		invariant(ring.pop(value) && value == i, "");
+	invariant(ring.empty(), "");
+}
+
+// Each producer pushes increasing numbers, spinning while ring is full. Consumer checks per-producer order
+void test_producers(size_t producers, size_t capacity) {
+	const uint64_t COUNT = 200000;
+	Ring ring(capacity);
+	std::vector<std::thread> threads;
+	for (uint64_t p = 0; p != producers; ++p)
+		threads.emplace_back([&ring, p, COUNT]() {
+			for (uint64_t i = 0; i != COUNT; ++i) {
+				uint64_t value = (p << 32U) | i;
+				while (!ring.push(value))
+					std::this_thread::yield();
+			}
+		});
+	std::vector<uint64_t> next(producers, 0);
+	uint64_t total = 0;
+	uint64_t value = 0;
+	while (total != producers * COUNT) {
+		if (!ring.pop(value)) {
+			std::this_thread::yield();
+			continue;
+		}
+		const auto p = static_cast<size_t>(value >> 32U);
+		invariant(p < producers && (value & 0xFFFFFFFFU) == next[p], "per-producer order violated");
+		next[p] += 1;
+		total += 1;
+	}
+	for (auto &t : threads)
+		t.join();
+	invariant(ring.empty() && !ring.pop(value), "");
+	std::cout << "producers=" << producers << " capacity=" << capacity << " passed" << std::endl;
+}
+
+// Pushes beyond CAPACITY go to overflow, all handlers must run once in push order
+void test_post_queue_overflow() {
+	const size_t COUNT = crab::details::PostQueue::CAPACITY * 3 + 17;
+	crab::details::PostQueue queue;
+	std::vector<size_t> order;
+	for (size_t i = 0; i != COUNT; ++i)
+		queue.push([&order, i]() { order.push_back(i); });
+	invariant(!queue.empty(), "");
+	size_t passes = 0;
+	while (!queue.empty()) {
+		queue.run_all();
+		passes += 1;
+		if (passes == 1)  // interleave pushes with overflow still pending
+			for (size_t i = COUNT; i != COUNT + 10; ++i)
+				queue.push([&order, i]() { order.push_back(i); });
+	}
+	invariant(order.size() == COUNT + 10, "handlers lost or run twice");
+	for (size_t i = 0; i != order.size(); ++i)
+		invariant(order[i] == i, "overflow broke order");
+}
+
+int main() {
+	test_single_thread();
+	test_post_queue_overflow();
+	test_producers(1, 4);
+	test_producers(4, 4);
+	test_producers(4, 1024);
+	std::cout << "test_mpsc_ring passed" << std::endl;
+	return 0;
+}
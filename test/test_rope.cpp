@@ -0,0 +1,179 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include <crab/crab.hpp>
+
+uint8_t pattern(size_t pos) { return static_cast<uint8_t>(pos * 7 % 251); }
+
+// Like socket, reads across all slices in single call, up to random budget
+class Source : public crab::IStream {
+public:
+	explicit Source(crab::Random &rnd) : rnd(rnd) {}
+	size_t available = 0;  // bytes until "would block"
+	size_t pos       = 0;  // total bytes produced
+
+	size_t read_some(uint8_t *val, size_t count) override {
+		crab::MutableSlice slice{val, count};
+		return read_some(&slice, 1);
+	}
+	size_t read_some(const crab::MutableSlice *slices, size_t count) override {
+		size_t budget      = std::min(available, random_budget());
+		size_t total_count = 0;
+		for (size_t i = 0; i != count && budget != 0; ++i) {
+			const size_t rc = std::min(budget, slices[i].size);
+			for (size_t j = 0; j != rc; ++j)
+				slices[i].data[j] = pattern(pos++);
+			budget -= rc;
+			total_count += rc;
+		}
+		available -= total_count;
+		return total_count;
+	}
+
+private:
+	crab::Random &rnd;
+	size_t random_budget() {
+		return rnd() % 2 ? rnd() % 100 : rnd() % (crab::Rope::CHUNK_SIZE * crab::Rope::READ_CHUNKS * 2);
+	}
+};
+
+// Accepts up to random budget across slices and checks received bytes
+class Sink : public crab::OStream {
+public:
+	explicit Sink(crab::Random &rnd) : rnd(rnd) {}
+	size_t pos = 0;  // total bytes consumed
+
+	size_t write_some(const uint8_t *val, size_t count) override {
+		crab::ConstSlice slice{val, count};
+		return write_some(&slice, 1);
+	}
+	size_t write_some(const crab::ConstSlice *slices, size_t count) override {
+		invariant(count <= crab::Rope::WRITE_CHUNKS, "too many slices");
+		size_t budget      = rnd() % 4 == 0 ? std::numeric_limits<size_t>::max() : rnd() % 50000;
+		size_t total_count = 0;
+		for (size_t i = 0; i != count && budget != 0; ++i) {
+			invariant(slices[i].size != 0, "empty slice");
+			const size_t wc = std::min(budget, slices[i].size);
+			for (size_t j = 0; j != wc; ++j)
+				invariant(slices[i].data[j] == pattern(pos++), "data corrupted");
+			budget -= wc;
+			total_count += wc;
+		}
+		return total_count;
+	}
+
+private:
+	crab::Random &rnd;
+};
+
+size_t outstanding_chunks() {
+	const auto &stats = crab::SlabPool::current().get_stats();
+	return stats.ALLOC_count - stats.FREE_count;
+}
+
+void check_chunks(const crab::Rope &rope, size_t base) {
+	// Data may start anywhere in the first chunk, plus one empty chunk at back after write_count()
+	const size_t max_chunks = rope.size() / crab::Rope::CHUNK_SIZE + 3;
+	invariant(outstanding_chunks() - base <= max_chunks, "Rope holds too many chunks");
+	if (rope.empty())
+		invariant(outstanding_chunks() - base <= 1, "empty Rope must hold at most single chunk");
+}
+
+void test_random(uint64_t seed) {
+	crab::Random rnd(seed);
+	const size_t base = outstanding_chunks();
+	Source source(rnd);
+	Sink sink(rnd);
+	crab::Rope rope;
+	for (size_t step = 0; step != 10000; ++step) {
+		switch (rnd() % 6) {
+		case 0: {
+			source.available += rnd() % (crab::Rope::CHUNK_SIZE * 3);
+			const size_t was = rope.size();
+			const size_t rc  = rope.read_from(source);
+			invariant(rope.size() == was + rc, "");
+			break;
+		}
+		case 1: {  // byte-wise API must interleave with vectored one
+			uint8_t buf[40000];
+			const size_t count = rnd() % sizeof(buf);
+			for (size_t i = 0; i != count; ++i)
+				buf[i] = pattern(source.pos + i);
+			source.pos += count;
+			invariant(rope.write_some(buf, count) == count, "Rope must write all");
+			break;
+		}
+		case 2: {
+			const size_t max_count = rnd() % 2 ? rnd() % 1000 : rnd() % (rope.size() + 1);
+			const size_t was       = rope.size();
+			const size_t wc        = rope.write_to(sink, max_count);
+			invariant(wc <= max_count && rope.size() == was - wc, "");
+			break;
+		}
+		case 3: {
+			uint8_t buf[30000];
+			const size_t rc = rope.read_some(buf, rnd() % sizeof(buf));
+			for (size_t i = 0; i != rc; ++i)
+				invariant(buf[i] == pattern(sink.pos++), "data corrupted");
+			break;
+		}
+		case 4: {  // did_read can skip past contiguous part
+			if (rope.empty())
+				break;
+			const size_t count = rnd() % (rope.size() + 1);
+			rope.did_read(count);  // Following reads check that correct data was skipped
+			sink.pos += count;
+			break;
+		}
+		default: {
+			crab::Rope other(std::move(rope));
+			invariant(rope.empty(), "moved-from Rope must be empty");
+			rope = std::move(other);
+			break;
+		}
+		}
+		invariant(rope.size() == source.pos - sink.pos, "size accounting broken");
+		check_chunks(rope, base);
+	}
+	while (!rope.empty())
+		rope.write_to(sink);  // Sink accepts random part
+	invariant(sink.pos == source.pos, "");
+	invariant(outstanding_chunks() == base, "chunks leaked");
+	std::cout << "seed=" << seed << " bytes=" << source.pos << std::endl;
+}
+
+void test_edges() {
+	crab::Random rnd(0);
+	const size_t base = outstanding_chunks();
+	crab::Rope rope;
+	Source source(rnd);
+	invariant(rope.read_from(source) == 0 && rope.empty(), "");
+	invariant(outstanding_chunks() == base, "empty read must not keep chunk");
+	// Exactly full chunk, then next write starts new one
+	std::string data(crab::Rope::CHUNK_SIZE, 'x');
+	rope.write(data.data(), data.size());
+	invariant(rope.read_count() == crab::Rope::CHUNK_SIZE, "");
+	rope.write("y", 1);
+	invariant(rope.read_count() == crab::Rope::CHUNK_SIZE && rope.size() == crab::Rope::CHUNK_SIZE + 1, "");
+	invariant(outstanding_chunks() == base + 2, "");
+	rope.did_read(crab::Rope::CHUNK_SIZE);  // exactly first chunk
+	invariant(rope.read_count() == 1 && *rope.read_ptr() == 'y' && outstanding_chunks() == base + 1, "");
+	rope.did_read(1);
+	invariant(rope.empty() && outstanding_chunks() == base, "drained Rope must return last chunk");
+	rope.write_count();
+	rope.clear();
+	invariant(outstanding_chunks() == base, "");
+}
+
+int main() {
+	test_edges();
+	test_random(1);
+	test_random(2);
+	test_random(3);
+	std::cout << "test_rope passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <crab/crab.hpp>
+
+using crab::SlabPool;
+
+// Destroyed after thread_local pool of main thread, must return storage to depot
+static crab::Buffer static_buffer(100000);
+static crab::Rope static_rope;
+
+void test_sizes() {
+	invariant(SlabPool::chunk_size(0) == SlabPool::MIN_CHUNK_SIZE && SlabPool::chunk_size(1) == SlabPool::MIN_CHUNK_SIZE, "");
+	invariant(SlabPool::chunk_size(4097) == 8192 && SlabPool::chunk_size(SlabPool::MAX_CHUNK_SIZE) == SlabPool::MAX_CHUNK_SIZE, "");
+	invariant(SlabPool::chunk_size(SlabPool::MAX_CHUNK_SIZE + 1) == 0, "");
+
+	auto &pool       = SlabPool::current();
+	const auto stats = pool.get_stats();
+	std::vector<uint8_t *> chunks;
+	for (size_t i = 0; i != 100; ++i) {
+		chunks.push_back(pool.allocate(5000));
+		std::fill(chunks.back(), chunks.back() + 8192, static_cast<uint8_t>(i));
+	}
+	for (size_t i = 0; i != chunks.size(); ++i)
+		invariant(chunks[i][0] == i && chunks[i][8191] == i, "chunks overlap");
+	for (auto c : chunks)
+		pool.deallocate(c, 5000);
+	invariant(pool.get_stats().ALLOC_count - stats.ALLOC_count == 100 && pool.get_stats().FREE_count - stats.FREE_count == 100, "");
+	uint8_t *big = pool.allocate(SlabPool::MAX_CHUNK_SIZE + 1);
+	pool.deallocate(big, SlabPool::MAX_CHUNK_SIZE + 1);
+	invariant(pool.get_stats().HEAP_count == stats.HEAP_count + 1, "");
+}
+
+struct ThreadLocalHolder {
+	crab::Buffer buffer{SlabPool::MIN_CHUNK_SIZE};
+	crab::Rope rope;
+};
+
+// thread_local constructed before pool is destroyed after it, storage must go to depot and be reused
+void test_thread_exit() {
+	std::thread([]() {
+		static thread_local ThreadLocalHolder holder;  // Buffer and Rope do not allocate until first write
+		const std::string data(SlabPool::MIN_CHUNK_SIZE * 3, 'x');
+		holder.buffer.write(data.data(), SlabPool::MIN_CHUNK_SIZE);
+		holder.rope.write(data.data(), data.size());
+		invariant(SlabPool::current().get_stats().ALLOC_count != 0, "");
+	}).join();
+	std::thread([]() {
+		const size_t count = crab::Rope::CHUNK_SIZE;
+		for (size_t i = 0; i != 3; ++i)
+			SlabPool::thread_deallocate(SlabPool::thread_allocate(count), count);
+		invariant(SlabPool::current().get_stats().DEPOT_count != 0, "chunks of exited thread must be reused");
+	}).join();
+}
+
+// Chunk freed on other thread must be reusable by it
+void test_cross_thread() {
+	std::vector<uint8_t *> chunks;
+	for (size_t i = 0; i != 1000; ++i)
+		chunks.push_back(SlabPool::thread_allocate(SlabPool::MIN_CHUNK_SIZE));
+	std::thread([&]() {
+		for (auto c : chunks)
+			SlabPool::thread_deallocate(c, SlabPool::MIN_CHUNK_SIZE);
+	}).join();
+}
+
+int main() {
+	test_sizes();
+	test_thread_exit();
+	test_cross_thread();
+	const std::string data(100000, 'y');
+	static_buffer.write(data.data(), data.size());
+	static_rope.write(data.data(), data.size());
+	std::cout << "test_slab_pool passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include <crab/crab.hpp>
+
+using crab::details::etag_list_contains;
+using crab::details::parse_range_number;
+using crab::details::static_file_status;
+
+const char *const ETAG          = "\"3e8-1\"";
+const char *const LAST_MODIFIED = "Mon, 01 Jan 2024 00:00:00 GMT";
+
+crab::http::RequestHeader make_request(const std::string &range, const std::string &method = "GET") {
+	crab::http::RequestHeader request;
+	request.method = method;
+	request.path   = "/index.html";
+	if (!range.empty())
+		request.headers.push_back(crab::http::Header{"range", range});
+	return request;
+}
+
+void check(const crab::http::RequestHeader &request, uint64_t size, int status, uint64_t begin, uint64_t end) {
+	crab::details::StaticFile file;  // fd is not used
+	file.size          = size;
+	file.etag          = ETAG;
+	file.last_modified = LAST_MODIFIED;
+	uint64_t b = 12345, e = 12345;
+	const int s = static_file_status(request, file, b, e);
+	if (s != status || b != begin || e != end) {
+		std::cout << "range='" << (request.headers.empty() ? "" : request.headers.back().value) << "' status=" << s
+		          << " [" << b << ".." << e << ") expected " << status << " [" << begin << ".." << end << ")" << std::endl;
+		invariant(false, "wrong static file status");
+	}
+}
+
+void check_range(const std::string &range, int status, uint64_t begin, uint64_t end, uint64_t size = 1000) {
+	check(make_request(range), size, status, begin, end);
+}
+
+void test_parse_range_number() {
+	size_t pos      = 0;
+	uint64_t result = 1;
+	invariant(parse_range_number("123-", pos, result) && pos == 3 && result == 123, "");
+	pos = 3;
+	invariant(!parse_range_number("123-", pos, result) && pos == 3 && result == 0, "no digits");
+	pos = 0;
+	invariant(!parse_range_number("", pos, result), "");
+	pos = 0;
+	invariant(parse_range_number("18446744073709551615", pos, result) && result == std::numeric_limits<uint64_t>::max(), "");
+	pos = 0;
+	invariant(parse_range_number("99999999999999999999999999", pos, result) && pos == 26, "");
+	invariant(result == std::numeric_limits<uint64_t>::max(), "must saturate instead of overflow");
+	pos = 0;
+	invariant(parse_range_number("100000000000000000", pos, result) && result == 100000000000000000ULL, "");
+}
+
+void test_etag_list() {
+	invariant(etag_list_contains(ETAG, ETAG), "");
+	invariant(etag_list_contains("W/\"3e8-1\"", ETAG), "weak comparison for If-None-Match");
+	invariant(etag_list_contains("\"a\", \"b\" ,W/\"3e8-1\"", ETAG), "");
+	invariant(etag_list_contains(" * ", ETAG), "");
+	invariant(!etag_list_contains("", ETAG), "");
+	invariant(!etag_list_contains("\"3e8-1", ETAG) && !etag_list_contains("\"3e8-1\"x", ETAG), "");
+	invariant(!etag_list_contains("\"3e8-2\", \"*\"", ETAG), "quoted star is ordinary etag");
+}
+
+void test_ranges() {
+	check_range("", 200, 0, 1000);
+	check_range("bytes=0-99", 206, 0, 100);
+	check_range("bytes=0-0", 206, 0, 1);
+	check_range("bytes=5-", 206, 5, 1000);
+	check_range("bytes=999-", 206, 999, 1000);
+	check_range("bytes=500-5000", 206, 500, 1000);  // last past EOF is clamped
+	// Suffix
+	check_range("bytes=-100", 206, 900, 1000);
+	check_range("bytes=-1000", 206, 0, 1000);
+	check_range("bytes=-5000", 206, 0, 1000);
+	check_range("bytes=-0", 416, 0, 1000);
+	// First past EOF
+	check_range("bytes=1000-", 416, 0, 1000);
+	check_range("bytes=1000-2000", 416, 0, 1000);
+	check_range("bytes=0-", 416, 0, 0, 0);
+	check_range("bytes=-5", 416, 0, 0, 0);
+	// Multiple and invalid ranges are ignored
+	check_range("bytes=0-9,20-29", 200, 0, 1000);
+	check_range("bytes=0-9, 20-", 200, 0, 1000);
+	check_range("bytes=9-5", 200, 0, 1000);
+	check_range("bytes=-", 200, 0, 1000);
+	check_range("bytes=abc", 200, 0, 1000);
+	check_range("bytes=5", 200, 0, 1000);
+	check_range("bytes=1-2x", 200, 0, 1000);
+	check_range("items=0-9", 200, 0, 1000);
+	// Saturation
+	check_range("bytes=99999999999999999999999-", 416, 0, 1000);
+	check_range("bytes=0-99999999999999999999999", 206, 0, 1000);
+	check_range("bytes=-99999999999999999999999", 206, 0, 1000);
+	check_range("bytes=18446744073709551615-18446744073709551615", 416, 0, 1000);
+	check(make_request("bytes=0-", "HEAD"), 1000, 200, 0, 1000);  // Range is only for GET
+	check(make_request("bytes=0-", "POST"), 1000, 200, 0, 1000);
+}
+
+void test_conditionals() {
+	auto request = make_request("");
+	request.headers.push_back(crab::http::Header{"if-none-match", "W/\"3e8-1\""});
+	check(request, 1000, 304, 0, 1000);
+	request.method = "HEAD";
+	check(request, 1000, 304, 0, 1000);
+	request.method = "POST";
+	check(request, 1000, 200, 0, 1000);
+
+	request = make_request("");
+	request.headers.push_back(crab::http::Header{"if-modified-since", LAST_MODIFIED});
+	check(request, 1000, 304, 0, 1000);
+	request.headers.push_back(crab::http::Header{"if-none-match", "\"other\""});
+	check(request, 1000, 200, 0, 1000);  // If-None-Match takes precedence
+
+	request = make_request("bytes=10-19");
+	request.headers.push_back(crab::http::Header{"if-range", ETAG});
+	check(request, 1000, 206, 10, 20);
+	request.headers.back().value = LAST_MODIFIED;
+	check(request, 1000, 206, 10, 20);
+	request.headers.back().value = "W/\"3e8-1\"";
+	check(request, 1000, 200, 0, 1000);  // If-Range requires strong comparison
+	request.headers.back().value = "\"3e8-2\"";
+	check(request, 1000, 200, 0, 1000);
+	request.headers.back().value = "Tue, 02 Jan 2024 00:00:00 GMT";
+	check(request, 1000, 200, 0, 1000);
+}
+
+int main() {
+	test_parse_range_number();
+	test_etag_list();
+	test_ranges();
+	test_conditionals();
+	std::cout << "test_static_file passed" << std::endl;
+	return 0;
+}
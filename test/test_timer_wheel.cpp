@@ -0,0 +1,141 @@
+// Copyright (c) 2007-2023, Grigory Buteyko aka Hrissan
+// Licensed under the MIT License. See LICENSE for details.
+
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <crab/crab.hpp>
+
+struct Element {
+	crab::IntrusiveNode<Element> wheel_node;
+	uint64_t wheel_tick = 0;
+	bool fired          = false;
+};
+
+using Wheel = crab::IntrusiveTimerWheel<Element, &Element::wheel_node, &Element::wheel_tick>;
+
+// Checks that after advance() exactly elements with tick <= current are expired
+void drain_and_check(Wheel &wheel, std::vector<Element> &elements) {
+	while (wheel.has_expired()) {
+		Element &e = wheel.front_expired();
+		invariant(e.wheel_tick <= wheel.current_tick() && !e.fired, "element expired too early or twice");
+		e.fired = true;
+		wheel.erase(e);
+	}
+	size_t waiting = 0;
+	for (const auto &e : elements) {
+		if (e.fired)
+			continue;
+		invariant(e.wheel_tick > wheel.current_tick(), "element did not expire in time");
+		waiting += 1;
+	}
+	invariant(wheel.size() == waiting, "wrong size");
+}
+
+void check_next_tick(Wheel &wheel, const std::vector<Element> &elements) {
+	uint64_t next = std::numeric_limits<uint64_t>::max();
+	wheel.next_tick(next);
+	if (wheel.empty()) {
+		invariant(next == std::numeric_limits<uint64_t>::max(), "next_tick changed on empty wheel");
+		return;
+	}
+	invariant(next > wheel.current_tick(), "next_tick must be in the future");
+	for (const auto &e : elements)
+		if (!e.fired)
+			invariant(e.wheel_tick >= next, "next_tick must be lower bound");
+}
+
+uint64_t random_delay(crab::Random &rnd) {
+	switch (rnd() % 4) {
+	case 0:
+		return rnd() % 64;
+	case 1:
+		return rnd() % 5000;
+	case 2:
+		return rnd() % (uint64_t(1) << 24);
+	default:  // Beyond 2^36 horizon, must be parked and cascaded again
+		return rnd.pod<uint64_t>() % (uint64_t(1) << 40);
+	}
+}
+
+void test_random(uint64_t seed, uint64_t start) {
+	crab::Random rnd(seed);
+	Wheel wheel(start);
+	std::vector<Element> elements(2000);
+	for (auto &e : elements) {
+		e.wheel_tick = start + random_delay(rnd);
+		invariant(wheel.insert(e), "");
+		invariant(!wheel.insert(e), "double insert must be ignored");
+	}
+	drain_and_check(wheel, elements);  // delay 0 expires immediately
+	size_t steps = 0;
+	while (!wheel.empty()) {
+		check_next_tick(wheel, elements);
+		uint64_t next = std::numeric_limits<uint64_t>::max();
+		wheel.next_tick(next);
+		const uint64_t current = wheel.current_tick();
+		switch (rnd() % 4) {
+		case 0:
+			wheel.advance(current + 1);
+			break;
+		case 1:
+			wheel.advance(current + rnd() % 100);
+			break;
+		case 2:
+			wheel.advance(next - 1);  // lower bound, nothing must expire
+			invariant(!wheel.has_expired(), "element expired before next_tick");
+			wheel.advance(next);
+			break;
+		default:
+			wheel.advance(current + rnd() % (uint64_t(1) << 30));
+			break;
+		}
+		drain_and_check(wheel, elements);
+		// Reschedule some waiting elements, erase works the same for waiting elements
+		for (size_t i = 0; i != 5; ++i) {
+			Element &e = elements[rnd() % elements.size()];
+			if (e.fired)
+				continue;
+			invariant(wheel.erase(e) == 1 && wheel.erase(e) == 0, "");
+			e.wheel_tick = wheel.current_tick() + 1 + random_delay(rnd);
+			wheel.insert(e);
+		}
+		steps += 1;
+	}
+	std::cout << "seed=" << seed << " start=" << start << " steps=" << steps << std::endl;
+}
+
+void test_expired_erase() {
+	Wheel wheel(100);
+	std::vector<Element> elements(3);
+	elements[0].wheel_tick = 50;  // in the past
+	elements[1].wheel_tick = 100;
+	elements[2].wheel_tick = 101;
+	for (auto &e : elements)
+		wheel.insert(e);
+	invariant(wheel.has_expired() && wheel.size() == 3, "");
+	wheel.erase(elements[0]);
+	wheel.erase(elements[1]);
+	invariant(!wheel.has_expired() && wheel.size() == 1, "expired element must be erasable");
+	uint64_t next = 1000;
+	wheel.next_tick(next);
+	invariant(next == 101, "exact tick for level 0");
+	wheel.advance(101);
+	invariant(wheel.has_expired() && &wheel.front_expired() == &elements[2], "");
+	wheel.erase(elements[2]);
+	invariant(wheel.empty(), "");
+	next = 1000;
+	wheel.next_tick(next);  // slots with stale occupied bits must be skipped
+	invariant(next == 1000, "");
+}
+
+int main() {
+	test_expired_erase();
+	test_random(1, 0);
+	test_random(2, 63);  // level 0 wraps on first tick
+	test_random(3, (uint64_t(1) << 36) - 5);  // all levels wrap soon
+	test_random(4, std::numeric_limits<uint32_t>::max());
+	std::cout << "test_timer_wheel passed" << std::endl;
+	return 0;
+}